@@ -23,6 +23,233 @@
 
 #include "LiquidCrystal.h"
 
+// writing a 1 to a PINx bit toggles the output on the parts listed
+// here. that's a single store, so an ISR changing other bits of the same
+// port can't have its change lost. anything not listed (ATmega8/16/32/64/128
+// and their A revisions, 162, 163, 323, 8515, 8535...) uses
+// read-modify-write with interrupts off instead.
+#if defined (__AVR_ATmega48__) || defined (__AVR_ATmega48A__) || defined (__AVR_ATmega48P__) || \
+	defined (__AVR_ATmega48PA__) || defined (__AVR_ATmega48PB__) || defined (__AVR_ATmega88__) || \
+	defined (__AVR_ATmega88A__) || defined (__AVR_ATmega88P__) || defined (__AVR_ATmega88PA__) || \
+	defined (__AVR_ATmega88PB__) || defined (__AVR_ATmega168__) || defined (__AVR_ATmega168A__) || \
+	defined (__AVR_ATmega168P__) || defined (__AVR_ATmega168PA__) || defined (__AVR_ATmega168PB__) || \
+	defined (__AVR_ATmega328__) || defined (__AVR_ATmega328P__) || defined (__AVR_ATmega328PB__) || \
+	defined (__AVR_ATmega164A__) || defined (__AVR_ATmega164P__) || defined (__AVR_ATmega164PA__) || \
+	defined (__AVR_ATmega324A__) || defined (__AVR_ATmega324P__) || defined (__AVR_ATmega324PA__) || \
+	defined (__AVR_ATmega324PB__) || defined (__AVR_ATmega644__) || defined (__AVR_ATmega644A__) || \
+	defined (__AVR_ATmega644P__) || defined (__AVR_ATmega644PA__) || defined (__AVR_ATmega1284__) || \
+	defined (__AVR_ATmega1284P__) || defined (__AVR_ATmega640__) || defined (__AVR_ATmega1280__) || \
+	defined (__AVR_ATmega1281__) || defined (__AVR_ATmega2560__) || defined (__AVR_ATmega2561__) || \
+	defined (__AVR_ATmega8U2__) || defined (__AVR_ATmega16U2__) || defined (__AVR_ATmega32U2__) || \
+	defined (__AVR_ATmega16U4__) || defined (__AVR_ATmega32U4__) || defined (__AVR_AT90USB82__) || \
+	defined (__AVR_AT90USB162__) || defined (__AVR_AT90USB646__) || defined (__AVR_AT90USB647__) || \
+	defined (__AVR_AT90USB1286__) || defined (__AVR_AT90USB1287__) || defined (__AVR_ATmega128RFA1__) || \
+	defined (__AVR_ATmega256RFR2__) || defined (__AVR_ATmega2564RFR2__) || defined (__AVR_ATtiny13__) || \
+	defined (__AVR_ATtiny13A__) || defined (__AVR_ATtiny24__) || defined (__AVR_ATtiny24A__) || \
+	defined (__AVR_ATtiny44__) || defined (__AVR_ATtiny44A__) || defined (__AVR_ATtiny84__) || \
+	defined (__AVR_ATtiny84A__) || defined (__AVR_ATtiny25__) || defined (__AVR_ATtiny45__) || \
+	defined (__AVR_ATtiny85__) || defined (__AVR_ATtiny2313__) || defined (__AVR_ATtiny2313A__) || \
+	defined (__AVR_ATtiny4313__) || defined (__AVR_ATtiny261__) || defined (__AVR_ATtiny261A__) || \
+	defined (__AVR_ATtiny461__) || defined (__AVR_ATtiny461A__) || defined (__AVR_ATtiny861__) || \
+	defined (__AVR_ATtiny861A__)
+#define _PIN_TOGGLE 1
+// EN rests low, so each write to its PINx bit is one edge
+#define _EN_HIGH() (*_EN_PIN = _EN_BIT)
+#define _EN_LOW() (*_EN_PIN = _EN_BIT)
+#else
+#define _PIN_TOGGLE 0
+#define _EN_HIGH() _setPin (_EN_PORT, _EN_PIN, _EN_BIT, HIGH)
+#define _EN_LOW() _setPin (_EN_PORT, _EN_PIN, _EN_BIT, LOW)
+#endif
+
+// powers of ten for the division free decimal conversion
+static const uint32_t lcd_pow10[] PROGMEM = {
+	1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+	10000UL, 1000UL, 100UL, 10UL
+};
+
+// character ROM codes for U+00A0...U+00FF on an A00 ROM, letters it
+// doesn't have are shown without their accents
+static const uint8_t lcd_latinA00[] PROGMEM = {
+	' ',  '!',  0xEC, 0xED, '?',  0x5C, '|',  '?',  '"',  'c',  'a',  '<',  '-',  '-',  'R',  '-', // A0 (¢ £ ¥)
+	0xDF, '+',  '2',  '3',  '\'', 0xE4, 'P',  0xA5, ',',  '1',  'o',  '>',  '?',  '?',  '?',  '?', // B0 (° µ ·)
+	'A',  'A',  'A',  'A',  'A',  'A',  'A',  'C',  'E',  'E',  'E',  'E',  'I',  'I',  'I',  'I', // C0
+	'D',  'N',  'O',  'O',  'O',  'O',  'O',  'x',  'O',  'U',  'U',  'U',  'U',  'Y',  'P',  0xE2, // D0 (ß)
+	'a',  'a',  'a',  'a',  0xE1, 'a',  'a',  'c',  'e',  'e',  'e',  'e',  'i',  'i',  'i',  'i', // E0 (ä)
+	'd',  0xEE, 'o',  'o',  'o',  'o',  0xEF, 0xFD, 'o',  'u',  'u',  'u',  0xF5, 'y',  'p',  'y'  // F0 (ñ ö ÷ ü)
+};
+
+// code point to character ROM code, sorted by code point
+struct lcd_rom_t {
+	uint16_t cp;
+	uint8_t code;
+};
+
+// A00 (Japanese) ROM, besides Latin-1 and half width katakana
+static const lcd_rom_t lcd_romA00[] PROGMEM = {
+	{ 0x03A3, 0xF6 }, { 0x03A9, 0xF4 }, { 0x03B1, 0xE0 }, { 0x03B2, 0xE2 }, // Σ Ω α β
+	{ 0x03B5, 0xE3 }, { 0x03B8, 0xF2 }, { 0x03BC, 0xE4 }, { 0x03C0, 0xF7 }, // ε θ μ π
+	{ 0x03C1, 0xE6 }, { 0x03C3, 0xE5 }, { 0x2126, 0xF4 }, { 0x2190, 0x7F }, // ρ σ Ω ←
+	{ 0x2192, 0x7E }, { 0x221A, 0xE8 }, { 0x221E, 0xF3 }, { 0x2588, 0xFF }, // → √ ∞ █
+	{ 0x3001, 0xA4 }, { 0x3002, 0xA1 }, { 0x300C, 0xA2 }, { 0x300D, 0xA3 }, // 、 。 「 」
+	{ 0x30FB, 0xA5 }, { 0x4E07, 0xFB }, { 0x5186, 0xFC }, { 0x5343, 0xFA }  // ・ 万 円 千
+};
+
+// A02 (European) ROM, besides Latin-1
+static const lcd_rom_t lcd_romA02[] PROGMEM = {
+	{ 0x0393, 0x92 }, { 0x0398, 0x99 }, { 0x03A3, 0x94 }, { 0x03A9, 0x9A }, // Γ Θ Σ Ω
+	{ 0x03B1, 0x90 }, { 0x03B4, 0x9B }, { 0x03B5, 0x9E }, { 0x03C0, 0x93 }, // α δ ε π
+	{ 0x03C3, 0x95 }, { 0x03C4, 0x97 }, { 0x201C, 0x12 }, { 0x201D, 0x13 }, // σ τ “ ”
+	{ 0x2126, 0x9A }, { 0x2190, 0x1B }, { 0x2191, 0x18 }, { 0x2192, 0x1A }, // Ω(ohm) ← ↑ →
+	{ 0x2193, 0x19 }, { 0x21B5, 0x17 }, { 0x221E, 0x9C }, { 0x2229, 0x9F }, // ↓ ↵ ∞ ∩
+	{ 0x2264, 0x1C }, { 0x2265, 0x1D }, { 0x25B2, 0x1E }, { 0x25B6, 0x10 }, // ≤ ≥ ▲ ▶
+	{ 0x25BC, 0x1F }, { 0x25C0, 0x11 }, { 0x25CF, 0x16 }, { 0x2665, 0x9D }, // ▼ ◀ ● ♥
+	{ 0x266A, 0x91 }, { 0x266B, 0x96 }                                      // ♪ ♫
+};
+
+// character ROM code for a code point (or _UTF_BAD)
+static uint8_t lcd_romCode (uint16_t cp, uint8_t rom)
+{
+	const lcd_rom_t *tab = lcd_romA00;
+	uint8_t lo = 0;
+	uint8_t hi = (sizeof (lcd_romA00) / sizeof (*lcd_romA00));
+	uint8_t mid;
+	uint16_t key;
+
+	if (rom == ROM_A02) {
+		if ((cp >= 0xA0) && (cp < 0x100)) { // Latin-1 is in the same place
+			return cp;
+		}
+
+		tab = lcd_romA02;
+		hi = (sizeof (lcd_romA02) / sizeof (*lcd_romA02));
+
+	} else {
+		if ((cp >= 0xA0) && (cp < 0x100)) {
+			return pgm_read_byte (&lcd_latinA00[cp - 0xA0]);
+		}
+
+		if ((cp >= 0xFF61) && (cp <= 0xFF9F)) { // half width katakana
+			return ((cp - 0xFF61) + 0xA1);
+		}
+	}
+
+	while (lo < hi) { // binary search, 5 steps at most
+		mid = ((lo + hi) / 2);
+		key = pgm_read_word (&tab[mid].cp);
+
+		if (key == cp) {
+			return pgm_read_byte (&tab[mid].code);
+		}
+
+		(key < cp) ? lo = (mid + 1) : hi = mid;
+	}
+
+	return _UTF_BAD;
+}
+
+// feed one byte to a UTF-8 decoder, returns a character ROM code or
+// _UTF_MORE. an ASCII byte ends any unfinished character.
+static uint16_t lcd_utfDecode (lcd_utf_t *utf, uint8_t c, uint8_t rom)
+{
+	if (c < 0x80) {
+		utf->need = 0;
+		return c;
+	}
+
+	if ((c & 0xC0) == 0x80) { // continuation byte
+		if (!utf->need) {
+			return _UTF_MORE; // stray, drop it
+		}
+
+		utf->cp = (utf->cp > 0x3FF) ? 0xFFFF : ((utf->cp << 6) | (c & 0x3F)); // past 16 bits is "unknown"
+
+		if (--utf->need) {
+			return _UTF_MORE;
+		}
+
+		return lcd_romCode (utf->cp, rom);
+	}
+
+	if (c >= 0xF0) { // lead byte
+		utf->need = 3;
+		utf->cp = (c & 0x07);
+
+	} else if (c >= 0xE0) {
+		utf->need = 2;
+		utf->cp = (c & 0x0F);
+
+	} else {
+		utf->need = 1;
+		utf->cp = (c & 0x1F);
+	}
+
+	return _UTF_MORE;
+}
+
+// hex digit for 0...15 (no table, it would sit in SRAM)
+static char lcd_hexDigit (uint8_t n)
+{
+	return (n < 10) ? ('0' + n) : (('A' - 10) + n);
+}
+
+// clear a VT parser
+static void lcd_vtReset (lcd_vt_t *vt)
+{
+	vt->state = 0;
+	vt->cmd = 0;
+	vt->args = 8;
+	while (vt->args--) {
+		vt->arg[vt->args] = 0;
+	}
+	vt->args = 0;
+}
+
+// feed one character to a VT parser, returns _VT_PRINT, _VT_MORE or _VT_EXEC
+static uint8_t lcd_vtParse (lcd_vt_t *vt, uint8_t c)
+{
+	switch (vt->state) {
+		// state 0 is "ordinary character" or "ground state"
+		case 0: {
+			if (c == 0x1B) { // VT code starts with ESC
+				vt->state++; // flag "got ESC, look for more VT
+				return _VT_MORE; // got part of a vt sequence, don't print it
+			}
+			return _VT_PRINT; // parser is already clear
+		}
+		// state 1 is "got VT escape (0x1B) look for left bracket (0x5B)"
+		case 1: {
+			if (c == '[') { // VT esc code followed by "["
+				vt->state++; // flag "got a sequence, look for a param"
+				return _VT_MORE; // got part of a vt sequence, don't print it
+			}
+			break; // don't have esc[
+		}
+		// state 2...9 is "get parameter" (max 8 params)
+		case 2 ... 9: {
+			if (isdigit (c)) { // if 0...9 then it's a parameter
+				vt->arg[vt->args] *= 10; // parse out...
+				vt->arg[vt->args] += (c - '0'); // ...first param
+				return _VT_MORE; // got part of a vt sequence, don't print it
+
+			} else if (c == ';') { // semicolon flags a parameter delimiter
+				vt->args++; // count parsed arg
+				vt->state++; // flag "got param delimiter, look for next param"
+				return _VT_MORE; // got part of a vt sequence, don't print it
+
+			} else if (! ((c < '@') || (c > '~'))) { // 0x40...0x7E marks end of VT command
+				vt->cmd = c; // copy VT command
+				vt->args++; // normalize count
+				return _VT_EXEC; // got a valid sequence, exec it
+			}
+			break;
+		}
+	}
+
+	lcd_vtReset (vt); // unknown piece of vt, reject it and print
+	return _VT_PRINT;
+}
+
 // serial interface, hardware reset not available
 LiquidCrystal::LiquidCrystal (
 	uint8_t siso, uint8_t stb, uint8_t sck
@@ -39,6 +266,14 @@ LiquidCrystal::LiquidCrystal (
 	initalize (MODE_S, siso, stb, sck, reset, 0, 0, 0, 0, 0, 0, 0, NO_RST);
 }
 
+// 74HC595 shift register interface, 4 bit (write only, r/w must be tied low)
+LiquidCrystal::LiquidCrystal (
+	lcd_sr595_t, uint8_t dat, uint8_t clk, uint8_t latch
+)   // 4 (tagged)
+{
+	initalize (MODE_595, dat, latch, clk, NO_RST, 0, 0, 0, 0, 0, 0, 0, NO_RST);
+}
+
 // parallel interface 4 bits without active r/w (must tie r/w low manually)
 LiquidCrystal::LiquidCrystal (
 	uint8_t rs, /* no rw */ uint8_t en,
@@ -107,9 +342,53 @@ void LiquidCrystal::initalize (
 {
 	uint8_t n, x;
 
-	_bit_mode = bitmode; // 4 bit (0x04), 8 bit (0x08) or serial (0xFF) mode flag
+	_trace = 0; // not tracing
+	_field = 0; // no field table
+	_fieldSize = 0;
+	_anim = 0; // no animation table
+	_animSize = 0;
+	_boot = NO_BOOT; // begin() clears the screen
+	_bit_mode = bitmode; // 4 bit (0x04), 8 bit (0x08), serial (0xFF) or 74HC595 (0xFE) mode flag
+	_shift_mode = 0; // flag "not 74HC595 mode"
+	_hw_spi = 0; // flag "not using hardware SPI"
+	_sr_rs = 0xFF; // don't know what the 595 outputs are
+
+	if (_bit_mode == MODE_595) { // 0xFE == 74HC595 mode
+		_bit_mode = MODE_4; // 595 drives D7...D4 only
+		_serial_mode = 0; // flag "not serial mode"
+		_shift_mode = 1; // flag "we are in 74HC595 mode"
+		_rw_pin = NO_RW; // can't read through a 595
+		_reset_pin = NO_RST;
+		n = digitalPinToPort (rs); // DATA pin is on RS
+		_SIO_BIT = digitalPinToBitMask (rs);
+		_SIO_PORT = portOutputRegister (n);
+		_SIO_DDR = portModeRegister (n);
+		*_SIO_DDR |= _SIO_BIT;
+		*_SIO_PORT &= ~_SIO_BIT;
+		n = digitalPinToPort (rw); // LATCH pin is on RW
+		_STB_BIT = digitalPinToBitMask (rw);
+		_STB_PORT = portOutputRegister (n);
+		_STB_DDR = portModeRegister (n);
+		*_STB_DDR |= _STB_BIT;
+		*_STB_PORT &= ~_STB_BIT; // latch idles low, rising edge updates outputs
+		n = digitalPinToPort (en); // CLOCK pin is on EN
+		_SCK_BIT = digitalPinToBitMask (en);
+		_SCK_PORT = portOutputRegister (n);
+		_SCK_DDR = portModeRegister (n);
+		*_SCK_DDR |= _SCK_BIT;
+		*_SCK_PORT &= ~_SCK_BIT; // clock idles low, rising edge shifts
+#if defined (SPCR) && defined (PIN_SPI_MOSI) && defined (PIN_SPI_SCK) && defined (PIN_SPI_SS)
+		// if data and clock are on MOSI and SCK use the SPI hardware
+		if ((rs == PIN_SPI_MOSI) && (en == PIN_SPI_SCK)) {
+			n = digitalPinToPort (PIN_SPI_SS); // SS must be an output to stay SPI master
+			*portModeRegister (n) |= digitalPinToBitMask (PIN_SPI_SS);
+			SPCR = (_BV (SPE) | _BV (MSTR)); // enable, master, mode 0, msb first
+			SPSR = _BV (SPI2X); // clock = F_CPU / 2
+			_hw_spi = 1; // flag "using hardware SPI"
+		}
+#endif
 
-	if (_bit_mode == MODE_S) { // 0xFF == serial mode
+	} else if (_bit_mode == MODE_S) { // 0xFF == serial mode
 		_bit_mode = MODE_8; // reset it to 8 bit mode
 		_serial_mode = 1; // flag "we are in serial mode"
 		_reset_pin = d0; // alternate use of pin
@@ -158,12 +437,14 @@ void LiquidCrystal::initalize (
 		n = digitalPinToPort (rs); // register select
 		_RS_BIT = digitalPinToBitMask (rs); // get bitmasks for parallel I/O
 		_RS_PORT = portOutputRegister (n); // get output ports
+		_RS_PIN = portInputRegister (n); // get input ports
 		_RS_DDR = portModeRegister (n); // get DDR registers
 		*_RS_DDR |= _RS_BIT; // ddr = output
 		*_RS_PORT |= _RS_BIT; // initial setting RS = HIGH = data
 		n = digitalPinToPort (en); // enable
 		_EN_BIT = digitalPinToBitMask (en);
 		_EN_PORT = portOutputRegister (n);
+		_EN_PIN = portInputRegister (n);
 		_EN_DDR = portModeRegister (n);
 		*_EN_DDR |= _EN_BIT; // ddr = output
 		*_EN_PORT &= ~_EN_BIT; // initial = low
@@ -171,6 +452,7 @@ void LiquidCrystal::initalize (
 			n = digitalPinToPort (rw);
 			_RW_BIT = digitalPinToBitMask (rw);
 			_RW_PORT = portOutputRegister (n);
+			_RW_PIN = portInputRegister (n);
 			_RW_DDR = portModeRegister (n);
 			*_RW_DDR |= _RW_BIT; // ddr = output
 			*_RW_PORT &= ~_RW_BIT; // initial setting RW = LOW = write
@@ -187,6 +469,7 @@ void LiquidCrystal::initalize (
 			*_RST_PORT |= _RST_BIT; // raise reset pin
 		}
 
+		_busDir = _WRITE; // data pins start as outputs
 		x = 8;
 
 		while (x--) {
@@ -195,25 +478,41 @@ void LiquidCrystal::initalize (
 			_DATA_DDR[x] = portModeRegister (n); // get DDR register
 			_DATA_PORT[x] = portOutputRegister (n); // get output port register
 			_DATA_PIN[x] = portInputRegister (n); // get input port register
+			*_DATA_DDR[x] |= _BIT_MASK[x]; // ddr = output
 
 			// if we are in 4 bit mode then only set d7...d4
 			if (x == _bit_mode) {
 				break;
 			}
 		}
+
+		// 4 bit wiring has no d3...d0. point them at d4 with no bits set
+		// so the 8 bit function sets of begin() and resync() leave them alone
+		if (_bit_mode == MODE_4) {
+			for (x = 0; x < 4; x++) {
+				_BIT_MASK[x] = 0;
+				_DATA_DDR[x] = _DATA_DDR[4];
+				_DATA_PORT[x] = _DATA_PORT[4];
+				_DATA_PIN[x] = _DATA_PIN[4];
+			}
+		}
 	}
 
 	begin (16, 1);
 }
 
-void LiquidCrystal::init (uint8_t cols, uint8_t rows, uint8_t dotsize)
+void LiquidCrystal::init (uint8_t cols, uint8_t rows, uint8_t dotsize, uint8_t rom)
 {
-	begin (cols, rows, dotsize);
+	begin (cols, rows, dotsize, rom);
 }
 
-void LiquidCrystal::begin (uint8_t cols, uint8_t rows, uint8_t dotsize)
+// "rom" is the character ROM of the display for UTF-8 text (ROM_A00 or
+// ROM_A02). characters are changed to their ROM codes as they are
+// written, those the ROM doesn't have show as '?'. ROM_NONE sends bytes
+// as they are.
+void LiquidCrystal::begin (uint8_t cols, uint8_t rows, uint8_t dotsize, uint8_t rom)
 {
-	uint8_t x;
+	uint8_t x, restored;
 	_numCols = cols;
 	_numRows = rows;
 
@@ -226,6 +525,10 @@ void LiquidCrystal::begin (uint8_t cols, uint8_t rows, uint8_t dotsize)
 	__builtin_avr_delay_cycles (F_CPU / (_MSEC / 50.0));
 
 	x = _bit_mode; // save actual bitmode
+	_addr = NO_ADDR; // don't know where the display is
+	_wrote = 0; // nothing written yet
+	_updating = 0; // not inside beginUpdate()
+	_shift = 0; // no pending display shifts
 	_bit_mode = MODE_8; // force reset to be 8 bit
 
 	// build _displayMode template
@@ -268,14 +571,121 @@ void LiquidCrystal::begin (uint8_t cols, uint8_t rows, uint8_t dotsize)
 	_send_cmd (_displayFunction); // set the interface bit mode
 	_bit_mode = x; // now driver uses 4 or 8 bits
 	_send_cmd (_displayMode); // entry mode set
+	_sentMode = _displayMode;
+	_front = _back = 0; // not double buffered
+	restored = _restoreScreen(); // while the display is still off
 	_displayControl |= DISPLAYON;
 	_send_cmd (_displayControl); // turn display on
+	_sentControl = _displayControl;
 	if (_serial_mode) { // probably a VFD
 		_send_cmd (FUNCTIONSET);
 		_send_data (0); // set brightness 100% (VFD only)
 	}
-	clearScreen();  // clear display
+	_term = 0; // line feed on the last line wraps to the top
+	clearFields(); // no numeric fields (before clear() looks at them)
+
+	if (restored) {
+		home(); // undo any display shift left from before the reset
+
+	} else {
+		clearScreen();  // clear display
+	}
+
+	for (x = 0; x < _animSize; x++) {
+		_anim[x].slot = NO_ANIM; // no animations
+	}
 	vt_Reset(); // init vt parser
+	_rom = rom;
+	_utf.need = 0; // init UTF-8 decoder
+}
+
+// show the screen saved at EEPROM "addr" by saveScreen_E() as soon as
+// begin() has the display set up, before the application draws
+// anything. call it before begin(). nothing is restored if the image
+// is missing or was saved for a different display size.
+void LiquidCrystal::bootScreen (const uint8_t *addr)
+{
+	_boot = (uint16_t)((uintptr_t)(addr));
+}
+
+// save what is on the display (and the custom characters if they can
+// be read back) to EEPROM at "addr" for bootScreen(). needs a shadow
+// copy (setShadow or bufferMode) or a readable display. takes up to
+// LCD_BOOT_SIZE(cols, rows) bytes, returns the number used (0 = failed).
+size_t LiquidCrystal::saveScreen_E (const uint8_t *addr)
+{
+	uint8_t *ee = (uint8_t *)(addr);
+	uint8_t x, y, c, n;
+	uint8_t have = 0; // bits waiting in "bits"
+	uint16_t bits = 0;
+
+	if (!_front && !_readable()) {
+		return 0;
+	}
+
+	eeprom_update_byte (ee++, 0); // not valid until it's all written
+	eeprom_update_byte (ee++, _numCols);
+	eeprom_update_byte (ee++, _numRows);
+	eeprom_update_byte (ee++, _readable() ? _BOOT_GLYPHS : 0);
+
+	for (y = 0; y < _numRows; y++) {
+		if (!_front) {
+			_setAddr (_row_offsets[y]);
+		}
+
+		for (x = 0; x < _numCols; x++) {
+			eeprom_update_byte (ee++, _front ? _front[(y * _numCols) + x] : _recv_data());
+		}
+	}
+
+	if (_readable()) { // pack 5 bits of each CG RAM row
+		_send_cmd (SETCGRAMADDR);
+
+		for (n = 0; n < 64; n++) {
+			c = _recv_data();
+			bits = ((bits << 5) | (c & 0x1F));
+			have += 5;
+
+			if (have >= 8) {
+				have -= 8;
+				eeprom_update_byte (ee++, (bits >> have));
+			}
+		}
+
+		_setAddr (_cur_x + _row_offsets[_cur_y]);
+	}
+
+	eeprom_update_byte ((uint8_t *)(addr), _BOOT_MAGIC);
+	return (ee - addr);
+}
+
+// called by begin(): custom characters in one CG RAM burst, then one
+// burst per row. returns 0 if there is no usable boot screen.
+uint8_t LiquidCrystal::_restoreScreen (void)
+{
+	const uint8_t *ee = (const uint8_t *)((uintptr_t)(_boot));
+	uint8_t y;
+
+	if ((_boot == NO_BOOT) || (eeprom_read_byte (ee) != _BOOT_MAGIC)) {
+		return 0;
+	}
+
+	if ((eeprom_read_byte (ee + 1) != _numCols) || (eeprom_read_byte (ee + 2) != _numRows)) {
+		return 0;
+	}
+
+	if (eeprom_read_byte (ee + 3) & _BOOT_GLYPHS) {
+		_loadPacked (0, (ee + 4 + (_numCols * _numRows)), _SRC_EE, 8);
+	}
+
+	ee += 4;
+
+	for (y = 0; y < _numRows; y++) {
+		_burst (0, y, (const char *)(ee), _numCols, _SRC_EE);
+		ee += _numCols;
+	}
+
+	return 1;
 }
 
 void LiquidCrystal::setBrightness (uint8_t pct)
@@ -311,6 +721,62 @@ void LiquidCrystal::setBrightness (uint8_t pct)
 	_send_data (brite); // set brightness (VFD only)
 }
 
+// returns 1 if the display's address counter is where the driver
+// thinks it is. a 4 bit display that gained or lost a nibble (EMI on
+// EN) answers with garbage. returns 1 if the display can't be read.
+uint8_t LiquidCrystal::isSynced (void)
+{
+	uint8_t stat;
+	uint8_t n = 10;
+
+	if (!_readable()) {
+		return 1;
+	}
+
+	if (_addr == NO_ADDR) { // give it a known address first
+		_send_cmd (SETDDRAMADDR | (_cur_x + _row_offsets[_cur_y]));
+	}
+
+	do {
+		stat = _recv_stat();
+	} while ((stat & _BUSY) && --n); // wait (a little) if busy
+
+	return ((stat & ~_BUSY) == _addr);
+}
+
+// get a 4 bit display back into nibble step without a full begin().
+// three 8 bit function sets put it in 8 bit mode whatever half of a
+// byte it was waiting for, then the saved function, entry mode and
+// display control are replayed and the cursor is put back. the screen
+// contents are not touched. returns isSynced(), call again if 0
+// (the first nibble may complete a slow "home" command).
+uint8_t LiquidCrystal::resync (void)
+{
+	uint8_t n;
+
+	if (_bit_mode == MODE_4) {
+		_bit_mode = MODE_8; // only d7...d4 go out, d3...d0 have no bits (see initalize)
+
+		for (n = 0; n < 3; n++) {
+			_send_cmd (FUNCTIONSET | BITMODE8);
+			__builtin_avr_delay_cycles (F_CPU / (_USEC / 100.0));
+		}
+
+		_send_cmd (FUNCTIONSET); // now 4 bit mode
+		__builtin_avr_delay_cycles (F_CPU / (_USEC / 100.0));
+		_bit_mode = MODE_4;
+	}
+
+	_send_cmd (_displayFunction);
+	_send_cmd (_displayMode);
+	_sentMode = _displayMode;
+	_send_cmd (_displayControl);
+	_sentControl = _displayControl;
+	_send_cmd (SETDDRAMADDR | (_cur_x + _row_offsets[_cur_y]));
+
+	return isSynced();
+}
+
 void LiquidCrystal::home (void)
 {
 	_send_cmd (RETURNHOME);
@@ -325,11 +791,80 @@ void LiquidCrystal::clearScreen (void)
 
 void LiquidCrystal::clear (void)
 {
+	uint8_t n;
+
+	_invalidateFields(); // fields must be redrawn in full
+
+	if (_back) { // double buffered, only clear the back buffer
+		n = (_numCols * _numRows);
+
+		while (n--) {
+			_back[n] = ' ';
+		}
+
+		setCursor (0, 0);
+		_autoPresent();
+		return;
+	}
+
 	_send_cmd (CLEARDISPLAY);
 	__builtin_avr_delay_cycles (F_CPU / (_MSEC / 20.0));
+
+	if (_front) { // keep shadow copy
+		n = (_numCols * _numRows);
+
+		while (n--) {
+			_front[n] = ' ';
+		}
+	}
+
 	setCursor (0, 0);
 }
 
+// blank one row and leave the cursor at its start (no 20 msec clear delay)
+void LiquidCrystal::clearLine (uint8_t row)
+{
+	if (row < _numRows) {
+		_invalidateFields();
+		_burst (0, row, 0, _numCols);
+		setCursor (0, row);
+		_autoPresent();
+	}
+}
+
+// blank from the cursor to the end of its row, the cursor doesn't move
+void LiquidCrystal::clearToEndOfLine (void)
+{
+	uint8_t x = _cur_x;
+	uint8_t y = _cur_y;
+
+	_invalidateFields();
+	_burst (x, y, 0, (_numCols - x));
+	setCursor (x, y);
+	_autoPresent();
+}
+
+// blank a w x h block at x, y and leave the cursor at x, y
+void LiquidCrystal::clearRegion (uint8_t x, uint8_t y, uint8_t w, uint8_t h)
+{
+	uint8_t n;
+
+	if ((x >= _numCols) || (y >= _numRows)) {
+		return;
+	}
+
+	w = (w > (_numCols - x)) ? (_numCols - x) : w; // clip to display
+	h = (h > (_numRows - y)) ? (_numRows - y) : h;
+	_invalidateFields();
+
+	for (n = 0; n < h; n++) {
+		_burst (x, (y + n), 0, w);
+	}
+
+	setCursor (x, y);
+	_autoPresent();
+}
+
 // if using a 16x4 LCD/VFD and line 3 & 4 are not placed correctly try:
 //    this ---> setRowOffsets(0x00, 0x40, 0x14, 0x54);
 // or this ---> setRowOffsets(0x00, 0x40, 0x10, 0x50);
@@ -356,7 +891,12 @@ void LiquidCrystal::setCursor (uint8_t x, uint8_t y)
 {
 	_cur_x = x; // record cursor X pos
 	_cur_y = y; // record cursor Y pos
-	_send_cmd (SETDDRAMADDR | (_cur_x + _row_offsets[_cur_y]));
+
+	if (_back) { // double buffered, present() sets the address
+		return;
+	}
+
+	_setAddr (_cur_x + _row_offsets[_cur_y]);
 }
 
 void LiquidCrystal::getCursor (uint8_t &x, uint8_t &y)
@@ -435,32 +975,37 @@ void LiquidCrystal::autoscroll (void)
 void LiquidCrystal::setDisplay (uint8_t on)
 {
 	on ? _displayControl |= DISPLAYON : _displayControl &= ~DISPLAYON;
-	_send_cmd (_displayControl);
+	_sendControl();
 }
 
 // Turns the underline cursor on/off
 void LiquidCrystal::setUnderline (uint8_t on)
 {
 	on ? _displayControl |= CURSORON : _displayControl &= ~CURSORON;
-	_send_cmd (_displayControl);
+	_sendControl();
 }
 
 // Turn on and off the blinking cursor
 void LiquidCrystal::setBlink (uint8_t on)
 {
 	on ? _displayControl |= BLINKON : _displayControl &= ~BLINKON;
-	_send_cmd (_displayControl);
+	_sendControl();
 }
 
 void LiquidCrystal::setAutoscroll (uint8_t on)
 {
 	on ? _displayMode |= DISPLAYSHIFT : _displayMode &= ~DISPLAYSHIFT;
-	_send_cmd (_displayMode);
+	_sendMode();
 }
 
 // These commands scroll the display without changing the RAM
 void LiquidCrystal::scrollDisplayLeft (void)
 {
+	if (_updating) { // net shift is sent by endUpdate()
+		_shift = (_shift > -((_displayFunction & LINES2) ? 40 : 80)) ? (_shift - 1) : 0;
+		return;
+	}
+
 	_displayCursor |= (CURSORSHIFT | DISPLAYMOVE | MOVERIGHT);
 	_displayCursor &= ~MOVERIGHT;
 	_send_cmd (_displayCursor);
@@ -468,6 +1013,11 @@ void LiquidCrystal::scrollDisplayLeft (void)
 
 void LiquidCrystal::scrollDisplayRight (void)
 {
+	if (_updating) { // net shift is sent by endUpdate()
+		_shift = (_shift < ((_displayFunction & LINES2) ? 40 : 80)) ? (_shift + 1) : 0;
+		return;
+	}
+
 	_displayCursor |= (CURSORSHIFT | DISPLAYMOVE | MOVERIGHT);
 	_send_cmd (_displayCursor);
 }
@@ -476,14 +1026,43 @@ void LiquidCrystal::scrollDisplayRight (void)
 void LiquidCrystal::leftToRight (void)
 {
 	_displayMode |= INCREMENT;
-	_send_cmd (_displayMode);
+	_sendMode();
 }
 
 // This is for text that flows Right to Left
 void LiquidCrystal::rightToLeft (void)
 {
 	_displayMode &= ~INCREMENT;
-	_send_cmd (_displayMode);
+	_sendMode();
+}
+
+// hold back display control, entry mode and display shift commands
+// until endUpdate() so that a burst of changes costs at most one
+// command per register (plus the net display shift). may be nested.
+void LiquidCrystal::beginUpdate (void)
+{
+	_updating++;
+}
+
+void LiquidCrystal::endUpdate (void)
+{
+	if (_updating && --_updating) { // still nested
+		return;
+	}
+
+	_sendControl();
+	_sendMode();
+
+	while (_shift) {
+		if (_shift < 0) {
+			_shift++;
+			scrollDisplayLeft();
+
+		} else {
+			_shift--;
+			scrollDisplayRight();
+		}
+	}
 }
 
 // custom bitmaps in SRAM
@@ -545,43 +1124,145 @@ void LiquidCrystal::createChar_E (uint8_t addr, const uint8_t *bitmap)
 	home();  // make sure cursor isn't fubar
 }
 
-void LiquidCrystal::vt_Reset (void)
+// packed custom bitmaps: 5 bytes per character, the 8 rows of 5 bits
+// run together top row first, high bit first (see LCD_GLYPH_PACKED).
+// they are unpacked on the way to CG RAM.
+void LiquidCrystal::createCharPacked (uint8_t addr, const uint8_t *packed)
+{
+	_clearChar (addr); // erase old LCD/VFD data
+	_loadPacked (addr, packed, _SRC_RAM);
+	home();  // make sure cursor isn't fubar
+}
+
+// packed custom bitmaps in PROGMEM
+void LiquidCrystal::createCharPacked_P (uint8_t addr, const uint8_t *packed)
+{
+	_clearChar (addr); // erase old LCD/VFD data
+	_loadPacked (addr, packed, _SRC_PGM);
+	home();  // make sure cursor isn't fubar
+}
+
+// packed custom bitmaps in EEPROM
+void LiquidCrystal::createCharPacked_E (uint8_t addr, const uint8_t *packed)
+{
+	_clearChar (addr); // erase old LCD/VFD data
+	_loadPacked (addr, packed, _SRC_EE);
+	home();  // make sure cursor isn't fubar
+}
+
+// give animate() a table of size entries to keep its animations in
+// (null or 0 = no animations). all entries start out unused.
+void LiquidCrystal::setAnimations (lcd_anim_t *buf, uint8_t size)
 {
-	vt_state = 0;
-	vt_cmd = 0;
-	vt_args = 8;
-	while (vt_args--) {
-		vt_arg[vt_args] = 0;
+	uint8_t n;
+
+	_anim = size ? buf : 0;
+	_animSize = _anim ? size : 0;
+
+	for (n = 0; n < _animSize; n++) {
+		_anim[n].slot = NO_ANIM;
 	}
-	vt_args = 0;
 }
 
-size_t LiquidCrystal::vt_Exec (void)
+// animate custom character "slot" by rewriting its CG RAM from a
+// PROGMEM table of "count" 8 byte frames every "interval" msec.
+// every copy of the character on the display changes at once with no
+// DD RAM writes. call tick() from the main loop. returns 0 if the
+// animation table from setAnimations() is full or missing.
+uint8_t LiquidCrystal::animate (uint8_t slot, const uint8_t *frames, uint8_t count, uint16_t interval)
 {
-	uint8_t args;
+	uint8_t n;
 
-	switch (vt_cmd) {
-		case 'f':
-		case 'H': {
-			// must have 0, 1 or 2 params
-			// based on cols and rows starting at ZERO unlike the ANSI cmd
-			if (vt_args < 3) {
-				if ((vt_arg[0] < _numCols) && (vt_arg[1] < _numRows)) {
-					setLine (vt_arg[0], vt_arg[1]);
-				}
-			}
-			break;
-		}
-		case 'J': {
-			// valid param is missing, 0, 1, 2 or 3
-			if (vt_args < 4) {
-				clearScreen();
-			}
-			break;
+	slot %= 8;
+	stopAnimation (slot);
+
+	for (n = 0; n < _animSize; n++) {
+		if (_anim[n].slot == NO_ANIM) {
+			_anim[n].frames = frames;
+			_anim[n].slot = slot;
+			_anim[n].count = count ? count : 1;
+			_anim[n].frame = 0;
+			_anim[n].interval = interval;
+			_anim[n].last = millis();
+			_loadChar (slot, frames, _SRC_PGM); // show first frame now
+			_setAddr (_cur_x + _row_offsets[_cur_y]);
+			return 1;
 		}
-		case 'm': {
-			for (args = 0; args < vt_args; args++) { // handle multiple SGR params
-				switch (vt_arg[args]) {
+	}
+
+	return 0;
+}
+
+// stop animating a custom character (it keeps its current frame)
+void LiquidCrystal::stopAnimation (uint8_t slot)
+{
+	uint8_t n;
+
+	for (n = 0; n < _animSize; n++) {
+		if (_anim[n].slot == (slot % 8)) {
+			_anim[n].slot = NO_ANIM;
+		}
+	}
+}
+
+// non blocking animation step, uploads the next frame of any animation
+// that is due (8 bytes each) and restores the display address once.
+// in double buffered mode it also sends a due automatic present, so the
+// last frame goes out even when nothing more is written.
+void LiquidCrystal::tick (void)
+{
+	uint16_t now = millis();
+	uint8_t n, sent = 0;
+
+	for (n = 0; n < _animSize; n++) {
+		if ((_anim[n].slot == NO_ANIM) || ((uint16_t)(now - _anim[n].last) < _anim[n].interval)) {
+			continue;
+		}
+
+		_anim[n].last = now;
+		_anim[n].frame = ((_anim[n].frame + 1) < _anim[n].count) ? (_anim[n].frame + 1) : 0;
+		_loadChar (_anim[n].slot, (_anim[n].frames + (_anim[n].frame * 8)), _SRC_PGM);
+		sent = 1;
+	}
+
+	if (sent) { // CG RAM writes moved the address counter
+		_setAddr (_cur_x + _row_offsets[_cur_y]);
+	}
+
+	_autoPresent();
+}
+
+void LiquidCrystal::vt_Reset (void)
+{
+	lcd_vtReset (&_vt);
+}
+
+size_t LiquidCrystal::vt_Exec (void)
+{
+	uint8_t args;
+
+	switch (_vt.cmd) {
+		case 'f':
+		case 'H': {
+			// must have 0, 1 or 2 params
+			// based on cols and rows starting at ZERO unlike the ANSI cmd
+			if (_vt.args < 3) {
+				if ((_vt.arg[0] < _numCols) && (_vt.arg[1] < _numRows)) {
+					setLine (_vt.arg[0], _vt.arg[1]);
+				}
+			}
+			break;
+		}
+		case 'J': {
+			// valid param is missing, 0, 1, 2 or 3
+			if (_vt.args < 4) {
+				clearScreen();
+			}
+			break;
+		}
+		case 'm': {
+			for (args = 0; args < _vt.args; args++) { // handle multiple SGR params
+				switch (_vt.arg[args]) {
 					case 0: { // reset / normal
 						setBrightness (75);
 						continue;
@@ -608,50 +1289,27 @@ size_t LiquidCrystal::vt_Exec (void)
 
 size_t LiquidCrystal::write (uint8_t c)
 {
-	switch (vt_state) {
-		// state 0 is "ordinary character" or "ground state"
-		case 0: {
-			if (c == 0x1B) { // VT code starts with ESC
-				vt_state++; // flag "got ESC, look for more VT
-				return 0; // got part of a vt sequence, don't print it
+	uint16_t code;
 
-			} else { // not start of an ANSI sequence
-				vt_Reset(); // reset parser
-				break; // fall through to main write
-			}
-		}
-		// state 1 is "got VT escape (0x1B) look for left bracket (0x5B)"
-		case 1: {
-			if (c == '[') { // VT esc code followed by "["
-				vt_state++; // flag "got a sequence, look for a param"
-				return 0; // got part of a vt sequence, don't print it
+	if (_rom && ((c & 0x80) || _utf.need)) {
+		code = lcd_utfDecode (&_utf, c, _rom);
 
-			} else { // don't have esc[
-				vt_Reset(); // reset parser
-				break; // fall through to main write
-			}
+		if (code == _UTF_MORE) {
+			return 0; // got part of a character, don't print it
 		}
-		// state 2...9 is "get parameter" (max 8 params)
-		case 2 ... 9: {
-			if (isdigit (c)) { // if 0...9 then it's a parameter
-				vt_arg[vt_args] *= 10; // parse out...
-				vt_arg[vt_args] += (c - '0'); // ...first param
-				return 0; // got part of a vt sequence, don't print it
 
-			} else if (c == ';') { // semicolon flags a parameter delimiter
-				vt_args++; // count parsed arg
-				vt_state++; // flag "got param delimiter, look for next param"
-				return 0; // got part of a vt sequence, don't print it
+		if (c & 0x80) { // a whole character, never a control or VT code
+			_putChar (code);
+			return 1;
+		}
+	}
 
-			} else if (! ((c < '@') || (c > '~'))) { // 0x40...0x7E marks end of VT command
-				vt_cmd = c; // copy VT command
-				vt_args++; // normalize count
-				return vt_Exec(); // got a valid sequence, exec it
-			}
+	switch (lcd_vtParse (&_vt, c)) {
+		case _VT_MORE: {
+			return 0; // got part of a vt sequence, don't print it
 		}
-		default: {
-			vt_Reset(); // unknown piece of vt, reject it and print
-			break;
+		case _VT_EXEC: {
+			return vt_Exec(); // got a valid sequence, exec it
 		}
 	}
 
@@ -679,120 +1337,1321 @@ size_t LiquidCrystal::write (uint8_t c)
 		}
 
 		default: {
-			_send_data (c);
+			_putChar (c);
+			break;
+		}
+
+	}
 
-			if (_cur_x < (_numCols - 1)) { // if next col pos isn't at end
-				_cur_x++;
+	return 1;
+}
 
-			} else {
-				_cur_x = 0;
+// put a character at the cursor and advance (no control or VT handling)
+void LiquidCrystal::_putChar (uint8_t c)
+{
+	if (_back) { // double buffered, draw into back buffer
+		_back[(_cur_y * _numCols) + _cur_x] = c;
 
-				if (_cur_y < (_numRows - 1)) { // need new row
-					_cur_y++;
+	} else {
+		if (_displayMode & INCREMENT) { // a window or menu may have moved the address
+			_setAddr (_cur_x + _row_offsets[_cur_y]);
+		}
 
-				} else {
-					_cur_x = 0;
-					_cur_y = 0;
-				}
-			}
+		_send_data (c);
 
-			setCursor (_cur_x, _cur_y);
-			break;
+		if (_front) { // keep shadow copy
+			_front[(_cur_y * _numCols) + _cur_x] = c;
 		}
+	}
 
+	if (_cur_x < (_numCols - 1)) { // if next col pos isn't at end
+		_cur_x++;
+
+	} else {
+		_cur_x = 0;
+
+		if (_cur_y < (_numRows - 1)) { // need new row
+			_cur_y++;
+
+		} else if ((_term & TERM_SCROLL) && _scrollUp (0, 0, _numCols, _numRows)) {
+			_cur_x = 0;
+			_cur_y = (_numRows - 1);
+
+		} else {
+			_cur_x = 0;
+			_cur_y = 0;
+		}
 	}
 
-	return 1;
+	setCursor (_cur_x, _cur_y); // only sent at a line change
+	_autoPresent();
 }
 
-void LiquidCrystal::_clearChar (uint8_t addr)
+// formatted print, format string in SRAM
+size_t LiquidCrystal::printf (const char *fmt, ...)
+{
+	size_t n;
+	va_list ap;
+	va_start (ap, fmt);
+	n = _vprintf (fmt, ap, 0);
+	va_end (ap);
+	return n;
+}
+
+// formatted print, format string in PROGMEM
+size_t LiquidCrystal::printf_P (const char *fmt, ...)
+{
+	size_t n;
+	va_list ap;
+	va_start (ap, fmt);
+	n = _vprintf (fmt, ap, 1);
+	va_end (ap);
+	return n;
+}
+
+// give defineField() a table of size entries to keep its fields in
+// (null or 0 = no fields). any fields defined before are forgotten.
+void LiquidCrystal::setFields (lcd_field_t *buf, uint8_t size)
+{
+	_field = size ? buf : 0;
+	_fieldSize = _field ? size : 0;
+	_numFields = 0;
+}
+
+// define a fixed width numeric field at x, y. returns the field
+// id for updateField() or NO_FIELD if the field table from
+// setFields() is full or missing.
+// format = decimal places (0...9) | FIELD_ZERO | FIELD_LEFT | FIELD_PLUS
+uint8_t LiquidCrystal::defineField (uint8_t x, uint8_t y, uint8_t width, uint8_t format)
 {
 	uint8_t n;
-	_send_cmd (SETCGRAMADDR | ((addr % 8) * 8));
 
-	for (n = 0; n < 8; n++) {
-		_send_data (0); // erase old
+	if ((_numFields >= _fieldSize) || (x >= _numCols) || (y >= _numRows)) {
+		return NO_FIELD;
+	}
+
+	width = (width > LCD_FIELD_WIDTH) ? LCD_FIELD_WIDTH : width;
+	width = (width > (_numCols - x)) ? (_numCols - x) : width; // clip to display
+
+	_field[_numFields].x = x;
+	_field[_numFields].y = y;
+	_field[_numFields].width = width;
+	_field[_numFields].format = format;
+
+	for (n = 0; n < width; n++) {
+		_field[_numFields].last[n] = 0; // unknown, first update writes all
 	}
+
+	return _numFields++;
 }
 
-size_t LiquidCrystal::_backSpace (void)
+// show a value in a field. only the characters that differ from
+// what the field shows now are sent, one address set per changed run.
+// if the value doesn't fit the field is filled with '*'.
+void LiquidCrystal::updateField (uint8_t id, int32_t value)
 {
-	uint8_t _tmp_x = _cur_x;
-	uint8_t _tmp_y = _cur_y;
+	char buf[11];
+	char out[LCD_FIELD_WIDTH];
+	uint8_t n, x, len, lead, total, width, format, prec, sign;
 
-	if (_tmp_x) {
-		_tmp_x--;
+	if (id >= _numFields) {
+		return;
+	}
+
+	width = _field[id].width;
+	format = _field[id].format;
+	prec = (format & 0x0F);
+	sign = 0;
+
+	if (value < 0) {
+		value = -value;
+		sign = '-';
+
+	} else if (format & FIELD_PLUS) {
+		sign = '+';
+	}
+
+	len = _utoa (buf, (uint32_t)(value));
+	lead = (prec >= len) ? ((prec + 1) - len) : 0; // fixed point leading zeros
+	total = (sign ? 1 : 0) + lead + len + (prec ? 1 : 0);
+
+	if (total > width) { // won't fit
+		for (n = 0; n < width; n++) {
+			out[n] = '*';
+		}
 
 	} else {
-		_tmp_x = (_numCols - 1);
+		n = 0;
+		x = (width - total); // padding
 
-		if (_tmp_y) {
-			_tmp_y--;
+		if (! (format & (FIELD_LEFT | FIELD_ZERO))) {
+			while (x) {
+				out[n++] = ' ';
+				x--;
+			}
+		}
 
-		} else {
-			_tmp_y = (_numRows - 1);
+		if (sign) {
+			out[n++] = sign;
+		}
+
+		if ((format & FIELD_ZERO) && ! (format & FIELD_LEFT)) {
+			while (x) {
+				out[n++] = '0';
+				x--;
+			}
+		}
+
+		len += lead;
+
+		for (x = 0; x < len; x++) {
+			if (prec && ((len - x) == prec)) {
+				out[n++] = '.';
+			}
+
+			out[n++] = (x < lead) ? '0' : buf[x - lead];
+		}
+
+		while (n < width) { // left justified padding
+			out[n++] = ' ';
 		}
 	}
 
-	setCursor (_tmp_x, _tmp_y);
-	write ((uint8_t)(' '));
-	setCursor (_tmp_x, _tmp_y);
-	return 0;
+	_sendField (id, out);
 }
 
-size_t LiquidCrystal::_lineFeed (void)
+// show text in a field, left justified and clipped to the field width
+void LiquidCrystal::updateFieldText (uint8_t id, const char *str)
 {
-	if (_cur_y < (_numRows - 1)) {
-		_cur_y++;
+	char out[LCD_FIELD_WIDTH];
+	uint8_t n;
+
+	if (id >= _numFields) {
+		return;
+	}
+
+	for (n = 0; n < _field[id].width; n++) {
+		out[n] = *str ? *str++ : ' ';
+	}
+
+	_sendField (id, out);
+}
+
+// draw a screen from a template in PROGMEM. "text" holds the static
+// rows separated by newlines, each row is sent as one burst padded
+// with spaces to the display width (rows not in the text are blanked).
+// slot n of the "slots" table becomes field n, after this only
+// updateField() calls touch the display. returns the number of slots
+// that became fields, less than "count" if a slot didn't fit (no room left
+// in the setFields() table, wider than LCD_FIELD_WIDTH or off the
+// display).
+uint8_t LiquidCrystal::showTemplate (const char *text, const lcd_slot_t *slots, uint8_t count)
+{
+	uint8_t n;
+	uint8_t row, c;
+	lcd_slot_t slot;
+
+	for (row = 0; row < _numRows; row++) {
+		text += _burst (0, row, text, _numCols, (_SRC_PGM | _SRC_LINE));
+
+		while ((c = pgm_read_byte (text)) && (c != '\n')) { // skip anything too wide
+			text++;
+		}
+
+		if (c) { // skip the newline
+			text++;
+		}
+	}
+
+	setCursor (0, 0);
+	clearFields();
+
+	for (n = 0; n < count; n++) {
+		memcpy_P (&slot, (slots + n), sizeof (slot));
+
+		if ((slot.width > LCD_FIELD_WIDTH) || (defineField (slot.x, slot.y, slot.width, slot.format) == NO_FIELD)) {
+			break; // later slots would get the wrong field numbers
+		}
+	}
+
+	_autoPresent();
+	return n;
+}
+
+// draw text in the w x h box at x, y: word wrap (or clip at the right
+// edge), justify (TEXT_LEFT, TEXT_CENTER or TEXT_RIGHT) and blank the
+// rest of the box. each row is one address set and one burst. returns
+// how much of the text was used so the rest can go in another box.
+size_t LiquidCrystal::drawText (uint8_t x, uint8_t y, uint8_t w, uint8_t h, const char *str, uint8_t align, uint8_t wrap)
+{
+	return _drawText (x, y, w, h, str, align, wrap, _SRC_RAM);
+}
+
+// same as above, text in PROGMEM
+size_t LiquidCrystal::drawText_P (uint8_t x, uint8_t y, uint8_t w, uint8_t h, const char *str, uint8_t align, uint8_t wrap)
+{
+	return _drawText (x, y, w, h, str, align, wrap, _SRC_PGM);
+}
+
+size_t LiquidCrystal::_drawText (uint8_t x, uint8_t y, uint8_t w, uint8_t h, const char *str, uint8_t align, uint8_t wrap, uint8_t src)
+{
+	const char *p = str; // start of this row (null = no text left)
+	const char *end = str; // end of the text once it's all used
+	size_t next; // where the next row starts
+	uint8_t row, len, brk, left, c;
+
+	if (!w || (x >= _numCols) || (y >= _numRows)) {
+		return 0;
+	}
+
+	w = (w > (_numCols - x)) ? (_numCols - x) : w; // clip to display
+	h = (h > (_numRows - y)) ? (_numRows - y) : h;
+
+	for (row = 0; row < h; row++) {
+		len = brk = 0;
+		next = 0;
+
+		while (p) { // find where this row ends
+			c = _readByte ((const uint8_t *)(p + len), src);
+
+			if (!c || (c == '\n')) { // end of text or line
+				next = (len + (c ? 1 : 0));
+				break;
+			}
+
+			if (len == w) { // row is full
+				if (!wrap) { // clip, skip to the next line
+					next = len;
+
+					while ((c = _readByte ((const uint8_t *)(p + next), src)) && (c != '\n')) {
+						next++;
+					}
+
+					next += (c ? 1 : 0);
+
+				} else if ((c == ' ') || !brk) { // ends on a word (or one word too long)
+					next = len;
+
+				} else { // break after the last whole word
+					next = len = brk;
+				}
+
+				break;
+			}
+
+			if (c == ' ') {
+				brk = len; // a word ends here
+			}
+
+			len++;
+		}
+
+		while (len && (_readByte ((const uint8_t *)(p + (len - 1)), src) == ' ')) {
+			len--; // trailing spaces don't count for justifying
+		}
+
+		left = (w - len);
+		left = (align == TEXT_RIGHT) ? left : (align == TEXT_CENTER) ? (left / 2) : 0;
+
+		_burst (x, (y + row), 0, left);
+		_burst ((x + left), (y + row), p, len, src);
+		_burst ((x + left + len), (y + row), 0, ((w - left) - len));
+
+		if (p) {
+			c = next ? _readByte ((const uint8_t *)(p + (next - 1)), src) : 0;
+			p += next;
+
+			if (c != '\n') { // wrapped, don't start a row with spaces
+				while (_readByte ((const uint8_t *)(p), src) == ' ') {
+					p++;
+				}
+			}
+
+			if (!_readByte ((const uint8_t *)(p), src)) { // all used
+				end = p;
+				p = 0;
+			}
+		}
+	}
+
+	setCursor (x, y);
+	_autoPresent();
+	return ((p ? p : end) - str);
+}
+
+// after the display was blanked or scrolled under the fields, make the
+// next update of each field write all of it
+void LiquidCrystal::_invalidateFields (void)
+{
+	uint8_t id, n;
+
+	for (id = 0; id < _numFields; id++) {
+		for (n = 0; n < _field[id].width; n++) {
+			_field[id].last[n] = 0;
+		}
+	}
+}
+
+// send only the runs of a field that changed
+void LiquidCrystal::_sendField (uint8_t id, const char *out)
+{
+	uint8_t n = 0;
+	uint8_t x;
+
+	while (n < _field[id].width) {
+		if (out[n] == _field[id].last[n]) {
+			n++;
+			continue;
+		}
+
+		x = n; // start of changed run
+
+		while ((n < _field[id].width) && (out[n] != _field[id].last[n])) {
+			_field[id].last[n] = out[n];
+			n++;
+		}
+
+		_writeRun ((_field[id].x + x), _field[id].y, (out + x), (n - x));
+	}
+}
+
+// forget all numeric fields (the display is not changed)
+void LiquidCrystal::clearFields (void)
+{
+	_numFields = 0;
+}
+
+// start double buffered mode. front and back must each hold cols * rows
+// bytes. writes go to the back buffer and only present() (or an
+// automatic present limited to "fps" frames per second, call tick()
+// from the main loop so it isn't only checked when writing) sends the
+// cells that differ from the front buffer. the display is cleared.
+void LiquidCrystal::bufferMode (uint8_t *front, uint8_t *back, uint8_t fps)
+{
+	uint8_t n = (_numCols * _numRows);
+
+	noBufferMode();
+	clear(); // display and front buffer start out the same
+
+	while (n--) {
+		front[n] = back[n] = ' ';
+	}
+
+	_front = front;
+	_back = back;
+	_svc_x = _svc_y = 0;
+	_byte_us = 40; // HD44780 command time, service() measures the real cost
+	setFrameRate (fps);
+	_lastFrame = millis();
+}
+
+// present anything pending and go back to writing directly
+void LiquidCrystal::noBufferMode (void)
+{
+	present();
+	_front = _back = 0;
+	setCursor (_cur_x, _cur_y);
+}
+
+// max automatic presents per second, 0 = only present() updates the display
+void LiquidCrystal::setFrameRate (uint8_t fps)
+{
+	_frameTime = fps ? (1000 / fps) : 0;
+}
+
+// send the difference between back and front buffer to the display,
+// one address set plus a data burst for each changed run in a row
+void LiquidCrystal::present (void)
+{
+	uint8_t x, y, start, sent = 0;
+	uint8_t *f, *b;
+
+	if (!_back) {
+		return;
+	}
+
+	for (y = 0; y < _numRows; y++) {
+		f = (_front + (y * _numCols));
+		b = (_back + (y * _numCols));
+		x = 0;
+
+		while (x < _numCols) {
+			if (f[x] == b[x]) {
+				x++;
+				continue;
+			}
+
+			start = x; // start of changed run
+			_setAddr (start + _row_offsets[y]);
+
+			while ((x < _numCols) && (f[x] != b[x])) {
+				_send_data (b[x]);
+				f[x] = b[x];
+				x++;
+			}
+
+			sent = 1;
+		}
+	}
+
+	if (sent) { // put the display cursor back where the user expects it
+		_setAddr (_cur_x + _row_offsets[_cur_y]);
+	}
+
+	_lastFrame = millis();
+}
+
+// null terminated string in PROGMEM
+size_t LiquidCrystal::print_P (const char *str)
+{
+	return _writeSrc ((const uint8_t *)(str), (size_t)(-1), (_SRC_PGM | _SRC_STR));
+}
+
+// null terminated string in EEPROM
+size_t LiquidCrystal::print_E (const char *str)
+{
+	return _writeSrc ((const uint8_t *)(str), (size_t)(-1), (_SRC_EE | _SRC_STR));
+}
+
+// len bytes from PROGMEM
+size_t LiquidCrystal::write_P (const char *str, size_t len)
+{
+	return _writeSrc ((const uint8_t *)(str), len, _SRC_PGM);
+}
+
+// len bytes from EEPROM
+size_t LiquidCrystal::write_E (const char *str, size_t len)
+{
+	return _writeSrc ((const uint8_t *)(str), len, _SRC_EE);
+}
+
+// keep a copy of everything written to the display in buf (cols * rows
+// bytes), used by scrub(). the copy is read back from the display if
+// possible, else the display is cleared. null turns the copy off.
+// double buffered mode uses its own front buffer instead.
+void LiquidCrystal::setShadow (uint8_t *buf)
+{
+	uint8_t x, y;
+
+	if (_back) {
+		return;
+	}
+
+	_front = buf;
+	_scrub_x = _scrub_y = 0;
+
+	if (!buf) {
+		return;
+	}
+
+	if (_readable()) {
+		for (y = 0; y < _numRows; y++) {
+			_setAddr (_row_offsets[y]);
+
+			for (x = 0; x < _numCols; x++) {
+				*buf++ = _recv_data();
+			}
+		}
+
+		_setAddr (_cur_x + _row_offsets[_cur_y]);
+
+	} else {
+		clear();
+	}
+}
+
+// record every byte sent to or read from the display in buf (a ring
+// of size entries, the oldest are dropped). calling it again starts
+// a new trace, null stops tracing.
+void LiquidCrystal::trace (lcd_trace_t *buf, uint8_t size)
+{
+	_trace = size ? buf : 0;
+	_traceSize = size;
+	_traceHead = _traceCount = 0;
+	_traceTime = micros();
+}
+
+uint8_t LiquidCrystal::traceCount (void)
+{
+	return _traceCount;
+}
+
+// print the trace oldest first, one entry per line:
+// "C 80 40" = command 0x80, 40 usec after the previous entry.
+// C = command, D = data, S = status read, R = data read.
+size_t LiquidCrystal::dumpTrace (Print &out)
+{
+	lcd_trace_t *t;
+	uint8_t n, i;
+	size_t len = 0;
+
+	if (!_trace) {
+		return 0;
+	}
+
+	i = (_traceCount < _traceSize) ? 0 : _traceHead;
+
+	for (n = 0; n < _traceCount; n++) {
+		t = (_trace + i);
+		len += out.write ((t->flags & TRACE_RW) ? ((t->flags & TRACE_RS) ? 'R' : 'S') : ((t->flags & TRACE_RS) ? 'D' : 'C'));
+		len += out.write (' ');
+		len += out.write (lcd_hexDigit (t->data >> 4));
+		len += out.write (lcd_hexDigit (t->data & 0x0F));
+		len += out.write (' ');
+		len += out.println (t->usec);
+
+		if (++i == _traceSize) {
+			i = 0;
+		}
+	}
+
+	return len;
+}
+
+// check the next "cells" display characters against the shadow copy
+// and rewrite any that don't match. needs RW (or serial) and a shadow
+// copy (setShadow or bufferMode). returns the number of repairs.
+uint8_t LiquidCrystal::scrub (uint8_t cells)
+{
+	uint8_t *shadow;
+	uint8_t fixed = 0;
+
+	if (!_front || !_readable()) {
+		return 0;
+	}
+
+	while (cells--) {
+		shadow = (_front + ((_scrub_y * _numCols) + _scrub_x));
+		_setAddr (_scrub_x + _row_offsets[_scrub_y]); // sent at a line change or after a repair
+
+		if (_recv_data() != *shadow) {
+			_setAddr (_scrub_x + _row_offsets[_scrub_y]);
+			_send_data (*shadow);
+			fixed++;
+		}
+
+		if (++_scrub_x >= _numCols) {
+			_scrub_x = 0;
+			_scrub_y = ((_scrub_y + 1) < _numRows) ? (_scrub_y + 1) : 0;
+		}
+	}
+
+	_setAddr (_cur_x + _row_offsets[_cur_y]);
+
+	return fixed;
+}
+
+// double buffered mode: send pending changes for at most "budget"
+// microseconds, then return. cells are sent in display order starting
+// where the last call stopped, a cell written many times is sent once.
+// the cost of a run is estimated from the measured time per byte so a
+// run that won't fit is cut short. returns 1 when nothing is pending.
+uint8_t LiquidCrystal::service (uint16_t budget)
+{
+	unsigned long start = micros();
+	uint16_t cells = (_numCols * _numRows); // visit each cell once at most
+	uint16_t units = 0; // bytes sent (address sets count as one)
+	uint16_t used, fit;
+	uint8_t *f, *b;
+	uint8_t x = _svc_x;
+	uint8_t y = _svc_y;
+	uint8_t n, len;
+
+	if (!_back) { // writes go straight out, nothing is pending
+		return 1;
+	}
+
+	while (cells) {
+		f = (_front + ((y * _numCols) + x));
+		b = (_back + ((y * _numCols) + x));
+
+		if (*f == *b) {
+			cells--;
+			x++;
+
+		} else {
+			len = 1; // length of changed run
+
+			while (((x + len) < _numCols) && (len < cells) && (f[len] != b[len])) {
+				len++;
+			}
+
+			used = (micros() - start);
+			fit = (budget > used) ? ((budget - used) / _byte_us) : 0; // bytes that still fit
+
+			if (fit < 3) { // need address, one byte and the final cursor address
+				if (units) {
+					break;
+				}
+
+				fit = 3; // always send something so we make progress
+			}
+
+			len = (len > (fit - 2)) ? (fit - 2) : len;
+			_setAddr (x + _row_offsets[y]);
+
+			for (n = 0; n < len; n++) {
+				_send_data (b[n]);
+				f[n] = b[n];
+			}
+
+			units += (len + 1);
+			cells -= len;
+			x += len;
+		}
+
+		if (x >= _numCols) {
+			x = 0;
+			y = ((y + 1) < _numRows) ? (y + 1) : 0;
+		}
+	}
+
+	_svc_x = x;
+	_svc_y = y;
+
+	if (units) {
+		_setAddr (_cur_x + _row_offsets[_cur_y]);
+		units++;
+		used = (micros() - start);
+		_byte_us = ((used + (units - 1)) / units); // round up
+		_byte_us = _byte_us ? _byte_us : 1;
+	}
+
+	return !cells;
+}
+
+// TERM_SCROLL: a line feed (or text running off the end) on the last
+// line scrolls the display up instead of wrapping to the top. this needs
+// a copy of the screen: setShadow(), bufferMode() or a readable display.
+// TERM_CLREOL: a line feed clears from the cursor to the end of the line
+// it moves to (after a carriage return that is the whole line).
+void LiquidCrystal::setTerminal (uint8_t flags)
+{
+	_term = flags;
+}
+
+void LiquidCrystal::_clearChar (uint8_t addr)
+{
+	uint8_t n;
+	_send_cmd (SETCGRAMADDR | ((addr % 8) * 8));
+
+	for (n = 0; n < 8; n++) {
+		_send_data (0); // erase old
+	}
+}
+
+// write 8 bytes of character bitmap into CG RAM. leaves the display
+// addressing CG RAM, the caller must set a DD RAM address after.
+void LiquidCrystal::_loadChar (uint8_t addr, const uint8_t *bitmap, uint8_t src)
+{
+	uint8_t n;
+	_send_cmd (SETCGRAMADDR | ((addr % 8) * 8));
+
+	for (n = 0; n < 8; n++) {
+		_send_data (_readByte (bitmap + n, src));
+	}
+}
+
+// "count" packed characters go out as one CG RAM burst
+void LiquidCrystal::_loadPacked (uint8_t addr, const uint8_t *packed, uint8_t src, uint8_t count)
+{
+	uint16_t bits = 0;
+	uint8_t have = 0; // unused bits in "bits"
+	uint8_t n;
+	_send_cmd (SETCGRAMADDR | ((addr % 8) * 8));
+
+	for (n = 0; n < (count * 8); n++) {
+		if (have < 5) { // need another byte for this row
+			bits = ((bits << 8) | _readByte (packed++, src));
+			have += 8;
+		}
+
+		have -= 5;
+		_send_data ((bits >> have) & 0x1F);
+	}
+}
+
+size_t LiquidCrystal::_backSpace (void)
+{
+	uint8_t _tmp_x = _cur_x;
+	uint8_t _tmp_y = _cur_y;
+
+	if (_tmp_x) {
+		_tmp_x--;
+
+	} else {
+		_tmp_x = (_numCols - 1);
+
+		if (_tmp_y) {
+			_tmp_y--;
+
+		} else {
+			_tmp_y = (_numRows - 1);
+		}
+	}
+
+	setCursor (_tmp_x, _tmp_y);
+	write ((uint8_t)(' '));
+	setCursor (_tmp_x, _tmp_y);
+	return 0;
+}
+
+size_t LiquidCrystal::_lineFeed (void)
+{
+	uint8_t x = _cur_x; // scrolling moves it
+
+	if (_cur_y < (_numRows - 1)) {
+		_cur_y++;
+
+	} else if ((_term & TERM_SCROLL) && _scrollUp (0, 0, _numCols, _numRows)) {
+		setCursor (x, (_numRows - 1)); // new bottom line is already blank
+		_autoPresent();
+		return 0;
+
+	} else {
+		_cur_y = 0;
+	}
+
+	if (_term & TERM_CLREOL) { // old text doesn't show through short lines
+		clearToEndOfLine();
+	}
+
+	setCursor (_cur_x, _cur_y);
+	_autoPresent();
+	return  0;
+}
+
+size_t LiquidCrystal::_carriageReturn (void)
+{
+	setCursor (0, _cur_y);
+	return 0;
+}
+
+// move cursor to next tab stop (4 places = 1 "tab")
+size_t LiquidCrystal::_doTabs (uint8_t _tab_size)
+{
+	size_t n = 0;
+
+	if (! (_cur_x % _tab_size)) {
+		n += write ((uint8_t)(' '));
+	}
+
+	while (_cur_x % _tab_size) {
+		n += write ((uint8_t)(' '));
+	}
+
+	return n;
+}
+
+// small printf engine, every character goes through write() so control
+// characters and VT sequences in the format or the arguments still work.
+// conversions: %d %i %u %x %X %c %s %S (string in PROGMEM) and %%
+// flags: '-' left justify, '0' zero pad, '+' show sign, 'l' long arg
+// a precision on an integer is a fixed point position: ("%.2d", 1234) --> 12.34
+size_t LiquidCrystal::_vprintf (const char *fmt, va_list ap, uint8_t pgm)
+{
+	char buf[11]; // largest uint32_t is 10 digits
+	const char *str;
+	uint32_t val;
+	uint8_t c, x, flags, width, prec, len, lead, sign;
+	size_t n = 0;
+
+	while ((c = (pgm ? pgm_read_byte (fmt++) : *fmt++))) {
+
+		if (c != '%') {
+			n += write (c);
+			continue;
+		}
+
+		flags = width = prec = sign = 0;
+
+		while (1) { // parse flags
+			c = (pgm ? pgm_read_byte (fmt++) : *fmt++);
+
+			if (c == '-') {
+				flags |= _PF_LEFT;
+
+			} else if (c == '0') {
+				flags |= _PF_ZERO;
+
+			} else if (c == '+') {
+				flags |= _PF_PLUS;
+
+			} else {
+				break;
+			}
+		}
+
+		while (isdigit (c)) { // parse width
+			width = ((width * 10) + (c - '0'));
+			c = (pgm ? pgm_read_byte (fmt++) : *fmt++);
+		}
+
+		if (c == '.') { // parse precision
+			flags |= _PF_PREC;
+			c = (pgm ? pgm_read_byte (fmt++) : *fmt++);
+
+			while (isdigit (c)) {
+				prec = ((prec * 10) + (c - '0'));
+				c = (pgm ? pgm_read_byte (fmt++) : *fmt++);
+			}
+		}
+
+		if (c == 'l') { // long argument
+			flags |= _PF_LONG;
+			c = (pgm ? pgm_read_byte (fmt++) : *fmt++);
+		}
+
+		switch (c) {
+			case 'd':
+			case 'i': {
+				val = (flags & _PF_LONG) ? va_arg (ap, long) : va_arg (ap, int);
+
+				if ((int32_t)(val) < 0) {
+					val = -val;
+					sign = '-';
+
+				} else if (flags & _PF_PLUS) {
+					sign = '+';
+				}
+
+				len = _utoa (buf, val);
+				break;
+			}
+
+			case 'u': {
+				val = (flags & _PF_LONG) ? va_arg (ap, unsigned long) : va_arg (ap, unsigned int);
+				len = _utoa (buf, val);
+				break;
+			}
+
+			case 'x':
+			case 'X': {
+				val = (flags & _PF_LONG) ? va_arg (ap, unsigned long) : va_arg (ap, unsigned int);
+				len = 0;
+				x = 32;
+
+				while (x) { // nibbles, most significant first
+					x -= 4;
+					lead = ((val >> x) & 0x0F);
+
+					if (len || lead || !x) {
+						buf[len++] = (lead < 10) ? (lead + '0') : (lead + (c - ('x' - 'a') - 10));
+					}
+				}
+
+				break;
+			}
+
+			case 'c':
+			case 's':
+			case 'S': {
+				if (c == 'c') { // a character is a one byte string
+					buf[0] = va_arg (ap, int);
+					str = buf;
+					len = 1;
+
+				} else {
+					str = va_arg (ap, const char *);
+					len = (c == 'S') ? strlen_P (str) : strlen (str);
+				}
+
+				if ((flags & _PF_PREC) && (prec < len)) {
+					len = prec; // precision limits string length
+				}
+
+				if (! (flags & _PF_LEFT)) {
+					n += _pad (' ', (width > len) ? (width - len) : 0);
+				}
+
+				for (x = 0; x < len; x++) {
+					n += write ((uint8_t)((c == 'S') ? pgm_read_byte (str + x) : str[x]));
+				}
+
+				if (flags & _PF_LEFT) {
+					n += _pad (' ', (width > len) ? (width - len) : 0);
+				}
+
+				continue;
+			}
+
+			case '%': {
+				n += write ((uint8_t)('%'));
+				continue;
+			}
+
+			case 0: { // format ended inside a conversion
+				return n;
+			}
+
+			default: { // unknown conversion, ignore it
+				continue;
+			}
+		}
+
+		// numeric output: buf holds len digits, no sign
+		lead = 0; // leading zeros needed for the fixed point
+		prec = (c == 'd' || c == 'i' || c == 'u') ? prec : 0;
+
+		if (prec >= len) {
+			lead = ((prec + 1) - len);
+		}
+
+		x = (sign ? 1 : 0) + lead + len + (prec ? 1 : 0); // field length
+
+		if (! (flags & (_PF_LEFT | _PF_ZERO))) {
+			n += _pad (' ', (width > x) ? (width - x) : 0);
+		}
+
+		if (sign) {
+			n += write (sign);
+		}
+
+		if ((flags & _PF_ZERO) && ! (flags & _PF_LEFT)) {
+			n += _pad ('0', (width > x) ? (width - x) : 0);
+		}
+
+		len += lead; // digits including fixed point leading zeros
+
+		for (x = 0; x < len; x++) {
+			if (prec && ((len - x) == prec)) {
+				n += write ((uint8_t)('.'));
+			}
+
+			n += write ((uint8_t)((x < lead) ? '0' : buf[x - lead]));
+		}
+
+		if (flags & _PF_LEFT) {
+			x = (sign ? 1 : 0) + len + (prec ? 1 : 0);
+			n += _pad (' ', (width > x) ? (width - x) : 0);
+		}
+	}
+
+	return n;
+}
+
+// write a character "count" times
+size_t LiquidCrystal::_pad (uint8_t c, uint8_t count)
+{
+	size_t n = 0;
+
+	while (count--) {
+		n += write (c);
+	}
+
+	return n;
+}
+
+// unsigned to decimal by subtracting powers of ten, no 32 bit division.
+// returns the number of digits placed in buf (not null terminated).
+uint8_t LiquidCrystal::_utoa (char *buf, uint32_t val)
+{
+	uint32_t pow;
+	uint8_t n, len = 0;
+	char c;
+
+	for (n = 0; n < (sizeof (lcd_pow10) / sizeof (*lcd_pow10)); n++) {
+		pow = pgm_read_dword (&lcd_pow10[n]);
+		c = '0';
+
+		while (val >= pow) {
+			val -= pow;
+			c++;
+		}
+
+		if (len || (c != '0')) { // skip leading zeros
+			buf[len++] = c;
+		}
+	}
+
+	buf[len++] = ('0' + val); // units
+
+	return len;
+}
+
+// stream bytes from SRAM, PROGMEM or EEPROM without copying them.
+// printable characters go straight out as a data burst (the address
+// is only set at a line change), anything else goes through write()
+// so control characters and VT sequences still work.
+size_t LiquidCrystal::_writeSrc (const uint8_t *str, size_t len, uint8_t src)
+{
+	size_t n = 0;
+	uint8_t c;
+
+	while (len--) {
+		c = _readByte (str++, src);
+
+		if (!c && (src & _SRC_STR)) {
+			break;
+		}
+
+		if ((c >= ' ') && !_vt.state && !(_rom && ((c & 0x80) || _utf.need))) {
+			_putChar (c);
+			n++;
+
+		} else { // controls, vt sequences and UTF-8 go through write()
+			n += write (c);
+		}
+	}
+
+	return n;
+}
+
+// read one byte from SRAM, PROGMEM or EEPROM
+uint8_t LiquidCrystal::_readByte (const uint8_t *addr, uint8_t src)
+{
+	switch (src & ~(_SRC_STR | _SRC_LINE)) {
+		case _SRC_PGM: {
+			return pgm_read_byte (addr);
+		}
+		case _SRC_EE: {
+			return eeprom_read_byte (addr);
+		}
+		default: {
+			return *addr;
+		}
+	}
+}
+
+// write a run and leave the cursor after it, wrapping like write() does
+void LiquidCrystal::_writeRun (uint8_t x, uint8_t y, const char *buf, uint8_t len)
+{
+	_burst (x, y, buf, len);
+
+	if (_cur_x >= _numCols) { // ran to end of line
+		_cur_x = 0;
+		_cur_y = (_cur_y < (_numRows - 1)) ? (_cur_y + 1) : 0;
+		setCursor (_cur_x, _cur_y);
+	}
+
+	_autoPresent();
+}
+
+// one address set then a burst of data. _cur_x ends up after the run
+// (possibly past the end of the line, the caller fixes that).
+// if buf is null the run is filled with spaces. returns the number
+// of bytes taken from buf.
+uint8_t LiquidCrystal::_burst (uint8_t x, uint8_t y, const char *buf, uint8_t len, uint8_t src)
+{
+	uint8_t c = ' ';
+	uint8_t n = 0;
+
+	if (!len) { // nothing to send, don't move the address either
+		return 0;
+	}
+
+	setCursor (x, y);
+
+	while (len--) {
+		if (buf) {
+			c = _readByte ((const uint8_t *)(buf), src);
+
+			if ((src & _SRC_LINE) && (!c || (c == '\n'))) {
+				buf = 0; // end of line, pad the rest
+				c = ' ';
+
+			} else {
+				buf++;
+				n++;
+			}
+		}
+
+		if (_back) { // double buffered, draw into back buffer
+			_back[(_cur_y * _numCols) + _cur_x] = c;
+
+		} else {
+			_send_data (c);
+
+			if (_front) { // keep shadow copy
+				_front[(_cur_y * _numCols) + _cur_x] = c;
+			}
+		}
+
+		_cur_x++;
+	}
+
+	return n;
+}
+
+// present if double buffered and a frame time has elapsed
+void LiquidCrystal::_autoPresent (void)
+{
+	if (_back && _frameTime && ((millis() - _lastFrame) >= _frameTime)) {
+		present();
+	}
+}
+
+// scroll a w x h block at x, y up one line and blank the bottom line.
+// the text comes from the back buffer, the shadow copy or is read back
+// from the display, each changed line is one address set plus a burst
+// and lines that come out the same are skipped. if the text can't be
+// found the block is blanked instead and 0 is returned.
+uint8_t LiquidCrystal::_scrollUp (uint8_t x, uint8_t y, uint8_t w, uint8_t h)
+{
+	char buf[40]; // HD44780 has at most 40 columns
+	uint8_t *src;
+	uint8_t n, row;
+
+	_invalidateFields(); // text under the fields moves
+
+	for (row = 1; row < h; row++) {
+		src = (_front + ((y + row) * _numCols) + x); // only valid if _front
+
+		if (_back) {
+			memcpy (_back + (((y + row) - 1) * _numCols) + x, _back + ((y + row) * _numCols) + x, w);
+
+		} else if (_front) {
+			if (memcmp (src - _numCols, src, w)) { // skip lines that don't change
+				_burst (x, ((y + row) - 1), (const char *)(src), w);
+			}
+
+		} else if (_readable()) { // read back the row below
+			setCursor (x, (y + row)); // may be elided, _recv_data() sets it again after a write
+
+			for (n = 0; n < w; n++) {
+				buf[n] = _recv_data();
+			}
+
+			_burst (x, ((y + row) - 1), buf, w);
+
+		} else { // can't move the text, blank the block
+			clearRegion (x, y, w, h);
+			return 0;
+		}
+	}
+
+	if (_front && !_back) { // skip the bottom line if it's already blank
+		src = (_front + (((y + h) - 1) * _numCols) + x);
+
+		for (n = 0; (n < w) && (src[n] == ' '); n++);
+
+		if (n == w) {
+			return 1;
+		}
+	}
+
+	_burst (x, ((y + h) - 1), 0, w); // blank the new bottom line
+	return 1;
+}
+
+// true if we can read from the display
+uint8_t LiquidCrystal::_readable (void)
+{
+	return (_serial_mode || (!_shift_mode && (_rw_pin != NO_RW)));
+}
+
+uint8_t LiquidCrystal::_recv_stat (void)
+{
+	return _recv (_STAT); // rs = low
+}
+
+uint8_t LiquidCrystal::_recv_data (void)
+{
+	uint8_t c;
 
-	} else {
-		_cur_y = 0;
+	if (_wrote && (_addr != NO_ADDR)) { // the first read after a write needs an address set
+		_send_cmd (SETDDRAMADDR | _addr);
 	}
 
-	setCursor (_cur_x, _cur_y);
-	return  0;
+	c = _recv (_DATA); // rs = high
+	_stepAddr(); // reading data moves the address counter too
+	return c;
 }
 
-size_t LiquidCrystal::_carriageReturn (void)
+// set the DD RAM address unless the display is already there
+void LiquidCrystal::_setAddr (uint8_t addr)
 {
-	setCursor (0, _cur_y);
-	return 0;
+	if (addr != _addr) {
+		_send_cmd (SETDDRAMADDR | addr);
+	}
 }
 
-// move cursor to next tab stop (4 places = 1 "tab")
-size_t LiquidCrystal::_doTabs (uint8_t _tab_size)
+// follow the display's address counter after a data read or write.
+// anything past the end of a line becomes "unknown" so the next
+// _setAddr() always goes out.
+void LiquidCrystal::_stepAddr (void)
 {
-	size_t n = 0;
-
-	if (! (_cur_x % _tab_size)) {
-		n += write ((uint8_t)(' '));
+	if (_addr == NO_ADDR) {
+		return;
 	}
 
-	while (_cur_x % _tab_size) {
-		n += write ((uint8_t)(' '));
-	}
+	(_sentMode & INCREMENT) ? _addr++ : _addr--;
 
-	return n;
+	if ((_displayFunction & LINES2) ? ((_addr & 0x3F) >= 0x28) : (_addr >= 0x50)) {
+		_addr = NO_ADDR;
+	}
 }
 
-uint8_t LiquidCrystal::_recv_stat (void)
+// send display control if it changed (and not inside beginUpdate)
+void LiquidCrystal::_sendControl (void)
 {
-	return _recv (_STAT); // rs = low
+	if (!_updating && (_displayControl != _sentControl)) {
+		_send_cmd (_displayControl);
+		_sentControl = _displayControl;
+	}
 }
 
-uint8_t LiquidCrystal::_recv_data (void)
+// send entry mode if it changed (and not inside beginUpdate)
+void LiquidCrystal::_sendMode (void)
 {
-	return _recv (_DATA); // rs = high
+	if (!_updating && (_displayMode != _sentMode)) {
+		_send_cmd (_displayMode);
+		_sentMode = _displayMode;
+	}
 }
 
+// every command goes through here so we can track what it
+// does to the address counter
 void LiquidCrystal::_send_cmd (uint8_t cmd)
 {
 	_send (cmd, _CMD); // rs = low
+	_wrote = 0;
+
+	if (cmd & SETDDRAMADDR) {
+		_addr = (cmd & ~SETDDRAMADDR);
+
+	} else if (cmd & (SETCGRAMADDR | FUNCTIONSET)) { // CG RAM or function set (VFD brightness follows)
+		_addr = NO_ADDR;
+
+	} else if (cmd & CURSORSHIFT) {
+		if (! (cmd & DISPLAYMOVE)) { // cursor move changes the address
+			_addr = NO_ADDR;
+		}
+
+	} else if (cmd < ENTRYMODESET) { // clear or home
+		_addr = 0;
+	}
 }
 
 void LiquidCrystal::_send_data (uint8_t dat)
 {
+	if (_displayMode != _sentMode) { // entry mode must be current before writing
+		_send_cmd (_displayMode);
+		_sentMode = _displayMode;
+	}
+
 	_send (dat, _DATA); // rs = high
+	_wrote = 1;
+	_stepAddr();
+}
+
+// drive one parallel bus pin high or low without disturbing the rest
+// of its port (see _PIN_TOGGLE)
+inline void LiquidCrystal::_setPin (volatile uint8_t *port, volatile uint8_t *pin, uint8_t bit, uint8_t level)
+{
+	if ((*port & bit) ? level : !level) { // already there (RS and RW usually are)
+		return;
+	}
+
+#if _PIN_TOGGLE
+	*pin = bit;
+#else
+	(void) pin; // only the toggle parts use it
+	uint8_t sreg = SREG;
+	cli();
+	level ? *port |= bit : *port &= ~bit;
+	SREG = sreg;
+#endif
 }
 
 // read either status or data determined by rs (register select)
@@ -804,6 +2663,10 @@ uint8_t LiquidCrystal::_recv (uint8_t rs)
 {
 	uint8_t c;
 
+	if (_trace) {
+		_record (0, rs ? (TRACE_RS | TRACE_RW) : TRACE_RW); // data filled in below
+	}
+
 	if (_serial_mode) { // set or clear RS bit in serial command byte
 		rs ? _serial_cmd |= _RSBIT : _serial_cmd &= ~_RSBIT;
 		_serial_cmd |= _RWBIT; // read mode
@@ -812,11 +2675,14 @@ uint8_t LiquidCrystal::_recv (uint8_t rs)
 		c = _serialRecv();  // recv data via serial
 		*_STB_PORT |= _STB_BIT; // de-assert strobe
 
+	} else if (_shift_mode) { // 74HC595 is write only
+		return 0;
+
 	} else { // set or clear RS pin (parallel mode)
-		rs ? *_RS_PORT |= _RS_BIT : *_RS_PORT &= ~_RS_BIT;
+		_setPin (_RS_PORT, _RS_PIN, _RS_BIT, rs);
 
 		if (_rw_pin != NO_RW) {
-			*_RW_PORT |= _RW_BIT; // set r/w high = read
+			_setPin (_RW_PORT, _RW_PIN, _RW_BIT, _READ); // set r/w high = read
 			_setDDR (_READ); // set port to read
 
 		} else {
@@ -832,6 +2698,10 @@ uint8_t LiquidCrystal::_recv (uint8_t rs)
 		}
 	}
 
+	if (_trace) {
+		_trace[(_traceHead ? _traceHead : _traceSize) - 1].data = c;
+	}
+
 	return c;
 }
 
@@ -842,6 +2712,10 @@ uint8_t LiquidCrystal::_recv (uint8_t rs)
 // ONLY IF the RW pin is selected, defined and used.
 void LiquidCrystal::_send (uint8_t c, uint8_t rs)
 {
+	if (_trace) {
+		_record (c, rs ? TRACE_RS : 0);
+	}
+
 	if (_serial_mode) { // set or clear RS bit in serial command byte
 		rs ? _serial_cmd |= _RSBIT : _serial_cmd &= ~_RSBIT;
 		_serial_cmd &= ~_RWBIT; // write mode
@@ -850,11 +2724,14 @@ void LiquidCrystal::_send (uint8_t c, uint8_t rs)
 		_serialSend (c); // send data via serial
 		*_STB_PORT |= _STB_BIT; // de-assert strobe
 
+	} else if (_shift_mode) { // RS and data go out through the 74HC595
+		_shiftSend (c, rs);
+
 	} else { // set or clear RS pin (parallel mode)
-		rs ? *_RS_PORT |= _RS_BIT : *_RS_PORT &= ~_RS_BIT;
+		_setPin (_RS_PORT, _RS_PIN, _RS_BIT, rs);
 
 		if (_rw_pin != NO_RW) {
-			*_RW_PORT &= ~_RW_BIT; // set r/w low = write
+			_setPin (_RW_PORT, _RW_PIN, _RW_BIT, _WRITE); // set r/w low = write
 			_setDDR (_WRITE); // set port to write
 		}
 
@@ -874,13 +2751,14 @@ uint8_t LiquidCrystal::_recv4bits (void)
 	uint8_t c = 0;
 	uint8_t n = 4;
 
+	_EN_HIGH(); // display drives the bus while EN is high
+	__builtin_avr_delay_cycles (F_CPU / (_USEC / 1.0));
+
 	while (n--) { // 4 bits parallel
 		*_DATA_PIN[n + 4] & _BIT_MASK[n + 4] ? c |= (1 << n) : c &= ~(1 << n); // receive bit
 	}
 
-	*_EN_PORT |= _EN_BIT;
-	__builtin_avr_delay_cycles (F_CPU / (_USEC / 1.0));
-	*_EN_PORT &= ~_EN_BIT;
+	_EN_LOW();
 	return c;
 }
 
@@ -890,13 +2768,14 @@ uint8_t LiquidCrystal::_recv8bits (void)
 	uint8_t c = 0;
 	uint8_t n = 8;
 
+	_EN_HIGH(); // display drives the bus while EN is high
+	__builtin_avr_delay_cycles (F_CPU / (_USEC / 1.0));
+
 	while (n--) { // 8 bits parallel
 		*_DATA_PIN[n] & _BIT_MASK[n] ? c |= (1 << n) : c &= ~(1 << n); // receive bit
 	}
 
-	*_EN_PORT |= _EN_BIT;
-	__builtin_avr_delay_cycles (F_CPU / (_USEC / 1.0));
-	*_EN_PORT &= ~_EN_BIT;
+	_EN_LOW();
 	return c;
 }
 
@@ -906,12 +2785,12 @@ void LiquidCrystal::_send4bits (uint8_t c)
 	uint8_t n = 4; // bit count
 
 	while (n--) { // 4 bits parallel
-		c & (1 << n) ? *_DATA_PORT[n + 4] |= _BIT_MASK[n + 4] : *_DATA_PORT[n + 4] &= ~_BIT_MASK[n + 4];
+		_setPin (_DATA_PORT[n + 4], _DATA_PIN[n + 4], _BIT_MASK[n + 4], (c & (1 << n)));
 	}
 
-	*_EN_PORT |= _EN_BIT;
+	_EN_HIGH();
 	__builtin_avr_delay_cycles (F_CPU / (_USEC / 1.0));
-	*_EN_PORT &= ~_EN_BIT; // latch data
+	_EN_LOW(); // latch data
 }
 
 // parallel 8 bit mode (we send all 8 bits at once)
@@ -920,12 +2799,12 @@ void LiquidCrystal::_send8bits (uint8_t c)
 	uint8_t n = 8; // bit count
 
 	while (n--) { // 8 bits parallel
-		c & (1 << n) ? *_DATA_PORT[n] |= _BIT_MASK[n] : *_DATA_PORT[n] &= ~_BIT_MASK[n];
+		_setPin (_DATA_PORT[n], _DATA_PIN[n], _BIT_MASK[n], (c & (1 << n)));
 	}
 
-	*_EN_PORT |= _EN_BIT;
+	_EN_HIGH();
 	__builtin_avr_delay_cycles (F_CPU / (_USEC / 1.0));
-	*_EN_PORT &= ~_EN_BIT; // latch data
+	_EN_LOW(); // latch data
 }
 
 void LiquidCrystal::_serialSend (uint8_t c)
@@ -959,10 +2838,98 @@ uint8_t LiquidCrystal::_serialRecv (void)
 	return c;
 }
 
+// 74HC595 4 bit mode (we send top 4 bits, then bottom 4)
+// while begin() forces 8 bit mode only the top 4 bits are sent, which
+// is exactly what a 4 bit wired display sees of an 8 bit function set
+void LiquidCrystal::_shiftSend (uint8_t c, uint8_t rs)
+{
+	uint8_t pattern = rs ? _SR_RS : 0;
+
+	if (_bit_mode == MODE_4) {
+		_shiftNibble (pattern | (c & 0xF0)); // send top half of byte
+		c <<= 4;
+	}
+
+	_shiftNibble (pattern | (c & 0xF0)); // send bottom half (or the only half)
+}
+
+// two shifts per nibble: latch data with EN high, then latch it again
+// with EN low. the display reads the bus on the falling edge of EN and
+// the second shift out keeps EN high well past its minimum pulse width.
+// RS must be steady before EN rises (tAS), so when it changes it is
+// latched with EN low first. that extra shift only happens when
+// switching between commands and data.
+void LiquidCrystal::_shiftNibble (uint8_t pattern)
+{
+	if ((pattern & _SR_RS) != _sr_rs) {
+		_shiftOut (pattern); // new RS + EN low
+		*_STB_PORT |= _STB_BIT; // latch
+		*_STB_PORT &= ~_STB_BIT;
+		_sr_rs = (pattern & _SR_RS);
+	}
+
+	_shiftOut (pattern | _SR_EN); // data + EN high
+	*_STB_PORT |= _STB_BIT; // latch
+	*_STB_PORT &= ~_STB_BIT;
+	_shiftOut (pattern); // same data + EN low
+	*_STB_PORT |= _STB_BIT; // latch (falling EN clocks the nibble in)
+	*_STB_PORT &= ~_STB_BIT;
+}
+
+void LiquidCrystal::_shiftOut (uint8_t c)
+{
+	uint8_t n = 8;
+
+#if defined (SPCR)
+	if (_hw_spi) {
+		SPDR = c; // start transfer
+		while (! (SPSR & _BV (SPIF))); // wait until done
+		return;
+	}
+#endif
+
+	while (n--) {
+		*_SCK_PORT &= ~_SCK_BIT; // set sck low
+		c & (1 << n) ? *_SIO_PORT |= _SIO_BIT : *_SIO_PORT &= ~_SIO_BIT; // write bit
+		*_SCK_PORT |= _SCK_BIT; // set sck high (595 shifts on rising edge)
+	}
+
+	*_SCK_PORT &= ~_SCK_BIT; // idle low
+}
+
+// add an entry to the bus trace, the oldest is dropped when it's full
+void LiquidCrystal::_record (uint8_t c, uint8_t flags)
+{
+	unsigned long now = micros();
+	unsigned long us = (now - _traceTime);
+	lcd_trace_t *t = (_trace + _traceHead);
+
+	t->usec = (us > 0xFFFF) ? 0xFFFF : us;
+	t->flags = flags;
+	t->data = c;
+	_traceTime = now;
+
+	if (++_traceHead == _traceSize) {
+		_traceHead = 0;
+	}
+
+	if (_traceCount < _traceSize) {
+		_traceCount++;
+	}
+}
+
+// set the data pins for reading or writing. only done when the
+// direction changes, so a run of writes touches the DDRs once.
 void LiquidCrystal::_setDDR (uint8_t pattern)
 {
 	uint8_t x = 8;
 
+	if (pattern == _busDir) {
+		return;
+	}
+
+	_busDir = pattern;
+
 	while (x--) {
 
 		pattern ? *_DATA_DDR[x] &= ~_BIT_MASK[x] : *_DATA_DDR[x] |= _BIT_MASK[x];
@@ -973,4 +2940,355 @@ void LiquidCrystal::_setDDR (uint8_t pattern)
 		}
 	}
 }
+// a window is a w x h block of the display at x, y
+LiquidCrystalWindow::LiquidCrystalWindow (
+	LiquidCrystal &lcd, uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t mode
+)
+{
+	_lcd = &lcd;
+	_x = x;
+	_y = y;
+	_w = w ? w : 1;
+	_h = h ? h : 1;
+	_mode = mode;
+	_cur_x = 0;
+	_cur_y = 0;
+	_utf.need = 0;
+	lcd_vtReset (&_vt);
+}
+
+// WIN_WRAP and/or WIN_SCROLL
+void LiquidCrystalWindow::setMode (uint8_t mode)
+{
+	_mode = mode;
+}
+
+void LiquidCrystalWindow::home (void)
+{
+	setCursor (0, 0);
+}
+
+// blank the window and home its cursor
+void LiquidCrystalWindow::clear (void)
+{
+	uint8_t x = _lcd->_cur_x; // the display's own cursor doesn't move
+	uint8_t y = _lcd->_cur_y;
+
+	_lcd->clearRegion (_x, _y, _w, _h);
+	_lcd->_cur_x = x;
+	_lcd->_cur_y = y;
+	home();
+}
+
+// position is relative to the window (nothing is sent to the display)
+void LiquidCrystalWindow::setCursor (uint8_t x, uint8_t y)
+{
+	_cur_x = (x < _w) ? x : (_w - 1);
+	_cur_y = (y < _h) ? y : (_h - 1);
+}
+
+void LiquidCrystalWindow::getCursor (uint8_t &x, uint8_t &y)
+{
+	x = _cur_x;
+	y = _cur_y;
+}
+
+// drawing goes through the display's _burst(), which moves its cursor.
+// put it back so the display and every window keep their own cursor,
+// the display sets its address again on its next write.
+size_t LiquidCrystalWindow::write (uint8_t c)
+{
+	uint8_t x = _lcd->_cur_x;
+	uint8_t y = _lcd->_cur_y;
+	size_t n = _write (c);
+
+	_lcd->_cur_x = x;
+	_lcd->_cur_y = y;
+	return n;
+}
+
+size_t LiquidCrystalWindow::_write (uint8_t c)
+{
+	uint16_t code;
+
+	if (_lcd->_rom && ((c & 0x80) || _utf.need)) { // UTF-8, see LiquidCrystal::write()
+		code = lcd_utfDecode (&_utf, c, _lcd->_rom);
+
+		if (code == _UTF_MORE) {
+			return 0;
+		}
+
+		if (c & 0x80) {
+			_putChar (code);
+			return 1;
+		}
+	}
+
+	switch (lcd_vtParse (&_vt, c)) {
+		case _VT_MORE: {
+			return 0; // got part of a vt sequence, don't print it
+		}
+		case _VT_EXEC: {
+			return _exec(); // got a valid sequence, exec it
+		}
+	}
+
+	switch (c) {
+		case '\b': {
+			if (_cur_x) {
+				_cur_x--;
+				write ((uint8_t)(' '));
+				_cur_x--;
+			}
+			return 0;
+		}
+
+		case '\t': { // next tab stop (4 places), at least one space
+			do {
+				write ((uint8_t)(' '));
+			} while ((_cur_x % 4) && (_cur_x < _w));
+			return 0;
+		}
+
+		case '\n': {
+			_lineFeed();
+			return 0;
+		}
+
+		case '\f': {
+			clear();
+			return 0;
+		}
+
+		case '\r': {
+			_cur_x = 0;
+			return 0;
+		}
+
+		default: {
+			_putChar (c);
+			break;
+		}
+	}
+
+	return 1;
+}
+
+// put a character at the cursor and advance (no control or VT handling)
+void LiquidCrystalWindow::_putChar (uint8_t c)
+{
+	uint8_t x, y;
+
+	if (_cur_x >= _w) { // past the right edge
+		if (! (_mode & WIN_WRAP)) {
+			return; // clipped
+		}
+
+		_cur_x = 0;
+		_lineFeed();
+	}
+
+	x = (_x + _cur_x);
+	y = (_y + _cur_y);
+
+	if ((x < _lcd->_numCols) && (y < _lcd->_numRows)) {
+		_lcd->_burst (x, y, (const char *)(&c), 1); // address only sent if it changed
+		_lcd->_autoPresent();
+	}
+
+	_cur_x++;
+}
+
+// VT commands relative to the window
+size_t LiquidCrystalWindow::_exec (void)
+{
+	switch (_vt.cmd) {
+		case 'f':
+		case 'H': {
+			if ((_vt.args < 3) && (_vt.arg[0] < _w) && (_vt.arg[1] < _h)) {
+				setCursor (_vt.arg[0], _vt.arg[1]);
+			}
+			break;
+		}
+		case 'J': {
+			if (_vt.args < 4) {
+				clear();
+			}
+			break;
+		}
+	}
+
+	lcd_vtReset (&_vt);
+	return 0;
+}
+
+// next line, at the bottom either scroll or wrap to the top
+void LiquidCrystalWindow::_lineFeed (void)
+{
+	uint8_t h = _h;
+
+	if (_cur_y < (_h - 1)) {
+		_cur_y++;
+
+	} else if (_mode & WIN_SCROLL) {
+		if ((_y + h) > _lcd->_numRows) { // clip to the display
+			h = (_lcd->_numRows > _y) ? (_lcd->_numRows - _y) : 0;
+		}
+
+		if (h && (_x < _lcd->_numCols)) {
+			if (!_lcd->_scrollUp (_x, _y, ((_x + _w) > _lcd->_numCols) ? (_lcd->_numCols - _x) : _w, h)) {
+				_cur_y = 0; // window was blanked, start at the top
+			}
+		}
+
+	} else {
+		_cur_y = 0;
+	}
+}
+
+// a menu is a w x h block of the display at x, y showing "count" items
+// from a PROGMEM table of PROGMEM strings
+LiquidCrystalMenu::LiquidCrystalMenu (
+	LiquidCrystal &lcd, uint8_t x, uint8_t y, uint8_t w, uint8_t h,
+	const char * const *items, uint8_t count, uint8_t marker
+)
+{
+	_lcd = &lcd;
+	_items = items;
+	_x = x;
+	_y = y;
+	_w = (w > 1) ? w : 2; // marker plus at least one character
+	_h = h ? h : 1;
+	_count = count;
+	_marker = marker;
+	_top = 0;
+	_sel = 0;
+}
+
+// draw the whole menu, one burst per row
+void LiquidCrystalMenu::draw (void)
+{
+	uint8_t rows = _rows();
+	uint8_t x = _lcd->_cur_x; // the display's own cursor doesn't move
+	uint8_t y = _lcd->_cur_y;
+	uint8_t row;
+
+	for (row = 0; row < rows; row++) {
+		_mark (row, ((_top + row) == _sel) ? _marker : ' ');
+		_lcd->_burst ((_x + 1), (_y + row), _label (_top + row), _cols(), (_SRC_PGM | _SRC_LINE));
+	}
+
+	_lcd->_cur_x = x;
+	_lcd->_cur_y = y;
+	_lcd->_autoPresent();
+}
+
+// select item "n", scrolling the menu if it isn't showing
+void LiquidCrystalMenu::select (uint8_t n)
+{
+	uint8_t rows = _rows();
+	uint8_t top = _top;
+	uint8_t x = _lcd->_cur_x; // the display's own cursor doesn't move
+	uint8_t y = _lcd->_cur_y;
+	uint8_t row;
+
+	if ((n >= _count) || !rows) {
+		return;
+	}
+
+	if (n < top) {
+		top = n;
+
+	} else if (n >= (top + rows)) {
+		top = ((n - rows) + 1);
+	}
+
+	if ((_sel - _top) != (n - top)) { // marker moves
+		_mark ((_sel - _top), ' ');
+		_mark ((n - top), _marker);
+	}
+
+	if (top != _top) {
+		for (row = 0; row < rows; row++) {
+			_diffRow (row, _label (_top + row), _label (top + row));
+		}
+	}
+
+	_top = top;
+	_sel = n;
+	_lcd->_cur_x = x;
+	_lcd->_cur_y = y;
+	_lcd->_autoPresent();
+}
+
+void LiquidCrystalMenu::next (void)
+{
+	select (_sel + 1);
+}
+
+void LiquidCrystalMenu::prev (void)
+{
+	if (_sel) {
+		select (_sel - 1);
+	}
+}
+
+uint8_t LiquidCrystalMenu::selected (void)
+{
+	return _sel;
+}
+
+// label of item "n" (null past the end)
+const char *LiquidCrystalMenu::_label (uint8_t n)
+{
+	return (n < _count) ? (const char *)(pgm_read_ptr (_items + n)) : 0;
+}
+
+// rows that fit on the display
+uint8_t LiquidCrystalMenu::_rows (void)
+{
+	if (_y >= _lcd->_numRows) {
+		return 0;
+	}
+
+	return ((_y + _h) > _lcd->_numRows) ? (_lcd->_numRows - _y) : _h;
+}
+
+// label columns that fit on the display
+uint8_t LiquidCrystalMenu::_cols (void)
+{
+	if ((_x + 1) >= _lcd->_numCols) {
+		return 0;
+	}
+
+	return ((_x + _w) > _lcd->_numCols) ? ((_lcd->_numCols - _x) - 1) : (_w - 1);
+}
+
+// put "c" in the marker cell of a row
+void LiquidCrystalMenu::_mark (uint8_t row, uint8_t c)
+{
+	if (_x < _lcd->_numCols) {
+		_lcd->_burst (_x, (_y + row), (const char *)(&c), 1);
+	}
+}
+
+// a row showed label "from", make it show label "to". only the part
+// from the first difference on is sent.
+void LiquidCrystalMenu::_diffRow (uint8_t row, const char *from, const char *to)
+{
+	uint8_t cols = _cols();
+	uint8_t col, a, b;
+
+	for (col = 0; col < cols; col++) {
+		a = from ? pgm_read_byte (from) : 0;
+		b = to ? pgm_read_byte (to) : 0;
+		from = a ? (from + 1) : 0; // past the end reads as spaces
+		to = b ? (to + 1) : 0;
+
+		if ((a ? a : ' ') != (b ? b : ' ')) {
+			_lcd->_burst ((_x + 1 + col), (_y + row), (b ? (to - 1) : 0), (cols - col), (_SRC_PGM | _SRC_LINE));
+			return;
+		}
+	}
+}
 // end of LiquidCrystal.cpp
@@ -30,6 +30,138 @@
 #include <Arduino.h>
 #endif
 
+#define LCD_FIELD_WIDTH 8 // max width of a numeric field
+
+// numeric field format: bits [3...0] = decimal places
+#define FIELD_ZERO  (1<<4) // pad with zeros instead of spaces
+#define FIELD_LEFT  (1<<5) // left justify
+#define FIELD_PLUS  (1<<6) // always show sign
+#define NO_FIELD      0xFF // defineField() failed
+
+// character ROM for UTF-8 text, see begin()
+#define ROM_NONE    0 // no decoding, bytes go to the display as they are
+#define ROM_A00     1 // HD44780 A00 (Japanese)
+#define ROM_A02     2 // HD44780 A02 (European)
+
+// EEPROM bytes needed by saveScreen_E()
+#define LCD_BOOT_SIZE(cols, rows) (4 + ((cols) * (rows)) + 40)
+
+// terminal flags
+#define TERM_SCROLL (1<<0) // line feed on the last line scrolls the display up
+#define TERM_CLREOL (1<<1) // line feed clears from the cursor to the end of the line it moves to
+
+// drawText() alignment
+#define TEXT_LEFT   0
+#define TEXT_CENTER 1
+#define TEXT_RIGHT  2
+
+// window flags
+#define WIN_WRAP    (1<<0) // text wraps to the next line at the right edge
+#define WIN_SCROLL  (1<<1) // line feed on the last line scrolls the window up
+
+#if __cplusplus >= 201103L
+// custom character from ASCII art, built at compile time. one 5 character
+// string per row, '#' = dot on, '.' or ' ' = dot off. for example:
+//
+//	const uint8_t bell[8] PROGMEM = LCD_GLYPH (
+//		"..#..", ".###.", ".###.", ".###.",
+//		"#####", ".....", "..#..", "....."
+//	);
+//	lcd.createChar_P (0, bell);
+//
+// a wrong number of rows, a row of the wrong length or any other
+// character is a compile error.
+#define LCD_GLYPH(r0, r1, r2, r3, r4, r5, r6, r7) { \
+	_LCD_GLYPH_ROW (r0), _LCD_GLYPH_ROW (r1), _LCD_GLYPH_ROW (r2), _LCD_GLYPH_ROW (r3), \
+	_LCD_GLYPH_ROW (r4), _LCD_GLYPH_ROW (r5), _LCD_GLYPH_ROW (r6), _LCD_GLYPH_ROW (r7) \
+}
+
+// same, packed into 5 bytes for createCharPacked(), _P() or _E()
+#define LCD_GLYPH_PACKED(r0, r1, r2, r3, r4, r5, r6, r7) { \
+	(uint8_t)((_LCD_GLYPH_ROW (r0) << 3) | (_LCD_GLYPH_ROW (r1) >> 2)), \
+	(uint8_t)((_LCD_GLYPH_ROW (r1) << 6) | (_LCD_GLYPH_ROW (r2) << 1) | (_LCD_GLYPH_ROW (r3) >> 4)), \
+	(uint8_t)((_LCD_GLYPH_ROW (r3) << 4) | (_LCD_GLYPH_ROW (r4) >> 1)), \
+	(uint8_t)((_LCD_GLYPH_ROW (r4) << 7) | (_LCD_GLYPH_ROW (r5) << 2) | (_LCD_GLYPH_ROW (r6) >> 3)), \
+	(uint8_t)((_LCD_GLYPH_ROW (r6) << 5) | _LCD_GLYPH_ROW (r7)) \
+}
+
+// the template argument forces the row to be converted by the compiler
+#define _LCD_GLYPH_ROW(s) (lcd_glyph_const<lcd_glyphRow (s)>::value)
+
+template <uint8_t V> struct lcd_glyph_const {
+	static const uint8_t value = V;
+};
+
+// not constexpr (and never defined) so a bad character can't compile
+uint8_t lcd_glyph_bad_character (void);
+
+constexpr uint8_t lcd_glyphDot (char c, uint8_t bit)
+{
+	return (c == '#') ? bit : ((c == '.') || (c == ' ')) ? 0 : lcd_glyph_bad_character();
+}
+
+template <size_t N> constexpr uint8_t lcd_glyphRow (const char (&s)[N])
+{
+	static_assert (N == 6, "LCD_GLYPH rows must be 5 characters");
+	return (lcd_glyphDot (s[0], (1<<4)) | lcd_glyphDot (s[1], (1<<3)) | lcd_glyphDot (s[2], (1<<2)) | lcd_glyphDot (s[3], (1<<1)) | lcd_glyphDot (s[4], (1<<0)));
+}
+#endif
+
+// VT parser state
+struct lcd_vt_t {
+	uint8_t state;
+	uint8_t cmd;
+	uint8_t args;
+	uint8_t arg[8];
+};
+
+// UTF-8 decoder state
+struct lcd_utf_t {
+	uint16_t cp; // code point so far
+	uint8_t need; // continuation bytes still to come
+};
+
+// screen template slot (in PROGMEM), slot n becomes field n
+struct lcd_slot_t {
+	uint8_t x;
+	uint8_t y;
+	uint8_t width;
+	uint8_t format; // field format, see defineField()
+};
+
+// bus trace flags
+#define TRACE_RS    (1<<0) // register select (data)
+#define TRACE_RW    (1<<1) // read
+
+// numeric field table entry, see setFields()
+struct lcd_field_t {
+	uint8_t x;
+	uint8_t y;
+	uint8_t width;
+	uint8_t format;
+	char last[LCD_FIELD_WIDTH]; // what is on the display now
+};
+
+// animation table entry, see setAnimations()
+struct lcd_anim_t {
+	const uint8_t *frames; // PROGMEM, 8 bytes per frame
+	uint8_t slot; // CG RAM slot 0...7 (NO_ANIM = unused)
+	uint8_t count; // number of frames
+	uint8_t frame; // frame now showing
+	uint16_t interval; // msec per frame
+	uint16_t last; // millis() of last frame change
+};
+
+// bus trace entry, see trace()
+struct lcd_trace_t {
+	uint16_t usec; // usec since the previous entry (65535 = or more)
+	uint8_t flags; // TRACE_RS, TRACE_RW
+	uint8_t data; // byte sent or received
+};
+
+// selects the 74HC595 shift register constructor
+enum lcd_sr595_t { SR595 };
+
 class LiquidCrystal : public Print {
 	public:
 		// serial, no reset
@@ -42,6 +174,14 @@ class LiquidCrystal : public Print {
 			uint8_t, uint8_t, uint8_t, uint8_t
 		); // 4
 
+		// 74HC595 shift register (data, clock, latch). with data on MOSI
+		// and clock on SCK this takes over the SPI peripheral (SPCR, SPSR,
+		// SS made an output) for good, so it can't share SPI with other
+		// devices. use other pins to bit bang instead.
+		LiquidCrystal (
+			lcd_sr595_t, uint8_t, uint8_t, uint8_t
+		); // 4 (tagged)
+
 		// 4 bit parallel, no r/w
 		LiquidCrystal (
 			uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t
@@ -83,14 +223,21 @@ class LiquidCrystal : public Print {
 			uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t
 		); // 13
 
-		void init (uint8_t, uint8_t, uint8_t = 0); // init is same as begin
-		void begin (uint8_t, uint8_t, uint8_t = 0);
+		void init (uint8_t, uint8_t, uint8_t = 0, uint8_t = ROM_NONE); // init is same as begin
+		void begin (uint8_t, uint8_t, uint8_t = 0, uint8_t = ROM_NONE);
+		void bootScreen (const uint8_t *);
+		size_t saveScreen_E (const uint8_t *);
 
 		// user commands
 		void setBrightness (uint8_t);
+		uint8_t isSynced (void);
+		uint8_t resync (void);
 		void home (void);
 		void clearScreen (void);
 		void clear (void);
+		void clearLine (uint8_t);
+		void clearToEndOfLine (void);
+		void clearRegion (uint8_t, uint8_t, uint8_t, uint8_t);
 		void setRowOffsets (uint8_t, uint8_t, uint8_t, uint8_t);
 		void setLine (uint8_t, uint8_t);
 		void getLine (uint8_t &, uint8_t &);
@@ -116,18 +263,55 @@ class LiquidCrystal : public Print {
 		void scrollDisplayRight (void);
 		void leftToRight (void);
 		void rightToLeft (void);
+		void beginUpdate (void);
+		void endUpdate (void);
 		void createChar (uint8_t, const char *);
 		void createChar (uint8_t, const uint8_t *);
 		void createChar_P (uint8_t, const char *);
 		void createChar_P (uint8_t, const uint8_t *);
 		void createChar_E (uint8_t, const char *);
 		void createChar_E (uint8_t, const uint8_t *);
+		void createCharPacked (uint8_t, const uint8_t *);
+		void createCharPacked_P (uint8_t, const uint8_t *);
+		void createCharPacked_E (uint8_t, const uint8_t *);
+		void setAnimations (lcd_anim_t *, uint8_t);
+		uint8_t animate (uint8_t, const uint8_t *, uint8_t, uint16_t);
+		void stopAnimation (uint8_t);
+		void tick (void);
 		void vt_Reset (void);
 		size_t vt_Exec (void);
 		size_t write (uint8_t);
 		using Print::write; // pull in write
+		size_t printf (const char *, ...);
+		size_t printf_P (const char *, ...);
+		size_t print_P (const char *);
+		size_t print_E (const char *);
+		size_t write_P (const char *, size_t);
+		size_t write_E (const char *, size_t);
+		void setFields (lcd_field_t *, uint8_t);
+		uint8_t defineField (uint8_t, uint8_t, uint8_t, uint8_t = 0);
+		void updateField (uint8_t, int32_t);
+		void updateFieldText (uint8_t, const char *);
+		uint8_t showTemplate (const char *, const lcd_slot_t *, uint8_t);
+		size_t drawText (uint8_t, uint8_t, uint8_t, uint8_t, const char *, uint8_t = TEXT_LEFT, uint8_t = 1);
+		size_t drawText_P (uint8_t, uint8_t, uint8_t, uint8_t, const char *, uint8_t = TEXT_LEFT, uint8_t = 1);
+		void clearFields (void);
+		void bufferMode (uint8_t *, uint8_t *, uint8_t = 0);
+		void noBufferMode (void);
+		void setFrameRate (uint8_t);
+		void present (void);
+		uint8_t service (uint16_t);
+		void setShadow (uint8_t *);
+		void setTerminal (uint8_t);
+		uint8_t scrub (uint8_t);
+		void trace (lcd_trace_t *, uint8_t);
+		uint8_t traceCount (void);
+		size_t dumpTrace (Print &);
 
 	private:
+		friend class LiquidCrystalWindow; // windows render through us
+		friend class LiquidCrystalMenu; // so do menus
+
 		// private code begins here
 		// hd44780 commands
 #define CLEARDISPLAY (1<<0)
@@ -161,8 +345,12 @@ class LiquidCrystal : public Print {
 #define MODE_4        0x04 // 4 bit parallel mode
 #define MODE_8        0x08 // 8 bit parallel or SPI mode
 #define MODE_S        0xFF // flag: serial SPI mode
+#define MODE_595      0xFE // flag: 74HC595 shift register mode
 #define NO_RW         0xFF // flag: read/write pin not used
 #define NO_RST        0xFF // flag: reset pin not used or not available
+#define NO_ADDR       0xFF // flag: display address counter unknown
+#define NO_ANIM       0xFF // flag: animation table entry unused
+#define NO_BOOT     0xFFFF // flag: no boot screen
 
 		// misc defines
 #define _READ         HIGH // read bit is 1
@@ -176,18 +364,71 @@ class LiquidCrystal : public Print {
 #define _RSBIT      (1<<1) // register select bit
 #define _RWBIT      (1<<2) // read/write bit (1=read, 0=write)
 #define _SYNC       ((1<<3)|(1<<4)|(1<<5)|(1<<6)|(1<<7)) // serial synchronous bits
+#define _BUSY       (1<<7) // status busy flag
+
+		// byte sources
+#define _SRC_RAM    0 // SRAM
+#define _SRC_PGM    1 // PROGMEM
+#define _SRC_EE     2 // EEPROM
+#define _SRC_STR    (1<<2) // stop at the terminating null
+#define _SRC_LINE   (1<<3) // stop at null or newline, pad with spaces
+
+		// UTF-8 decoder results
+#define _UTF_MORE  0x100 // part of a character, nothing to print
+#define _UTF_BAD     '?' // no ROM character for it
+
+		// VT parser results
+#define _VT_PRINT   0 // not part of a sequence, print it
+#define _VT_MORE    1 // part of a sequence, don't print it
+#define _VT_EXEC    2 // sequence complete, execute it
+
+		// printf flags
+#define _PF_LEFT    (1<<0) // '-' left justify
+#define _PF_ZERO    (1<<1) // '0' pad with zeros
+#define _PF_PLUS    (1<<2) // '+' always show sign
+#define _PF_PREC    (1<<3) // '.' precision was given
+#define _PF_LONG    (1<<4) // 'l' argument is long
+
+		// 74HC595 outputs: Q7...Q4 = D7...D4, Q3 = EN, Q2 = RS, Q1...Q0 unused
+#define _SR_EN      (1<<3) // enable bit
+#define _SR_RS      (1<<2) // register select bit
+
+// saved boot screen
+#define _BOOT_MAGIC   0xB5 // first byte of a valid image
+#define _BOOT_GLYPHS  (1<<0) // image has the 8 custom characters (packed)
 
 		// prototypes
 		void _clearChar (uint8_t);
+		void _loadChar (uint8_t, const uint8_t *, uint8_t);
+		void _loadPacked (uint8_t, const uint8_t *, uint8_t, uint8_t = 1);
+		uint8_t _restoreScreen (void);
 		size_t _backSpace (void);
 		size_t _lineFeed (void);
 		size_t _carriageReturn (void);
 		size_t _doTabs (uint8_t);
+		size_t _vprintf (const char *, va_list, uint8_t);
+		size_t _pad (uint8_t, uint8_t);
+		uint8_t _utoa (char *, uint32_t);
+		size_t _writeSrc (const uint8_t *, size_t, uint8_t);
+		uint8_t _readByte (const uint8_t *, uint8_t);
+		void _putChar (uint8_t);
+		void _writeRun (uint8_t, uint8_t, const char *, uint8_t);
+		uint8_t _burst (uint8_t, uint8_t, const char *, uint8_t, uint8_t = _SRC_RAM);
+		void _sendField (uint8_t, const char *);
+		void _invalidateFields (void);
+		size_t _drawText (uint8_t, uint8_t, uint8_t, uint8_t, const char *, uint8_t, uint8_t, uint8_t);
+		void _autoPresent (void);
+		uint8_t _scrollUp (uint8_t, uint8_t, uint8_t, uint8_t);
+		uint8_t _readable (void);
 		uint8_t _recv_stat (void);
 		uint8_t _recv_data (void);
 		uint8_t _recv (uint8_t);
 		uint8_t _recv4bits (void);
 		uint8_t _recv8bits (void);
+		void _setAddr (uint8_t);
+		void _stepAddr (void);
+		void _sendControl (void);
+		void _sendMode (void);
 		void _send_cmd (uint8_t);
 		void _send_data (uint8_t);
 		void _send (uint8_t, uint8_t);
@@ -195,7 +436,12 @@ class LiquidCrystal : public Print {
 		void _send8bits (uint8_t);
 		void _serialSend (uint8_t);
 		uint8_t _serialRecv (void);
+		void _shiftSend (uint8_t, uint8_t);
+		void _shiftNibble (uint8_t);
+		void _shiftOut (uint8_t);
 		void _setDDR (uint8_t);
+		void _setPin (volatile uint8_t *, volatile uint8_t *, uint8_t, uint8_t);
+		void _record (uint8_t, uint8_t);
 
 		// variables
 		uint8_t _cur_x;
@@ -207,17 +453,55 @@ class LiquidCrystal : public Print {
 		uint8_t _row_offsets[4];
 		uint8_t _serial_cmd;
 		uint8_t _serial_mode;
+		uint8_t _shift_mode;
+		uint8_t _hw_spi;
+		uint8_t _sr_rs; // RS last latched into the 74HC595 (0xFF = unknown)
 		uint8_t _rw_pin;
 		uint8_t _reset_pin;
 		uint8_t _bit_mode;
+		uint8_t _busDir; // data pins are set for _READ or _WRITE
 		uint8_t _displayMode;
 		uint8_t _displayControl;
 		uint8_t _displayCursor;
 		uint8_t _displayFunction;
-		uint8_t vt_state;
-		uint8_t vt_cmd;
-		uint8_t vt_args;
-		uint8_t vt_arg[8];
+		uint8_t _sentControl; // last _displayControl sent
+		uint8_t _sentMode; // last _displayMode sent
+		uint8_t _addr; // display address counter (or NO_ADDR)
+		uint8_t _wrote; // last transfer was a data write (next read is junk)
+		uint8_t _updating; // beginUpdate() nesting depth
+		int8_t _shift; // pending display shifts (+ right, - left)
+		lcd_vt_t _vt;
+		uint8_t _rom; // character ROM for UTF-8 (or ROM_NONE)
+		lcd_utf_t _utf;
+
+		// numeric fields (caller supplied table)
+		lcd_field_t *_field;
+		uint8_t _fieldSize; // entries in the table
+		uint8_t _numFields; // entries defined
+
+		// custom character animations (caller supplied table)
+		lcd_anim_t *_anim;
+		uint8_t _animSize; // entries in the table
+
+		// double buffering
+		uint8_t *_front; // what is on the display (cols * rows), also the shadow
+		uint8_t *_back; // what the user has drawn (cols * rows)
+		uint16_t _frameTime; // min msec between automatic presents, 0 = manual only
+		unsigned long _lastFrame; // millis() of last present
+		uint8_t _svc_x; // next cell service() checks
+		uint8_t _svc_y;
+		uint8_t _byte_us; // measured usec per byte sent
+		uint8_t _term; // terminal flags
+		uint16_t _boot; // EEPROM address of the boot screen (or NO_BOOT)
+		uint8_t _scrub_x; // next cell scrub() checks
+		uint8_t _scrub_y;
+
+		// bus trace (ring buffer)
+		lcd_trace_t *_trace; // null = not tracing
+		uint8_t _traceSize; // entries in the buffer
+		uint8_t _traceHead; // next entry to write
+		uint8_t _traceCount; // entries recorded (up to _traceSize)
+		unsigned long _traceTime; // micros() of the last entry
 
 		// pin bitmasks
 		uint8_t _BIT_MASK[8];
@@ -243,6 +527,11 @@ class LiquidCrystal : public Print {
 		// sio is needed as an input too
 		volatile uint8_t *_SIO_PIN;
 
+		// input ports, writing a 1 toggles the output
+		volatile uint8_t *_RS_PIN;
+		volatile uint8_t *_RW_PIN;
+		volatile uint8_t *_EN_PIN;
+
 		// port data direction registers
 		volatile uint8_t *_DATA_DDR[8];
 		volatile uint8_t *_RS_DDR;
@@ -254,4 +543,75 @@ class LiquidCrystal : public Print {
 		volatile uint8_t *_SIO_DDR;
 };
 
+// a rectangular area of the display with its own cursor and VT parser.
+// several windows can share one display without saving and restoring
+// the cursor, the display address is only sent when it has to change.
+class LiquidCrystalWindow : public Print {
+	public:
+		LiquidCrystalWindow (
+			LiquidCrystal &, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t = WIN_WRAP
+		); // display, x, y, width, height, flags
+
+		void setMode (uint8_t);
+		void home (void);
+		void clear (void);
+		void setCursor (uint8_t, uint8_t);
+		void getCursor (uint8_t &, uint8_t &);
+		size_t write (uint8_t);
+		using Print::write; // pull in write
+
+	private:
+		size_t _write (uint8_t);
+		size_t _exec (void);
+		void _lineFeed (void);
+		void _putChar (uint8_t);
+
+		LiquidCrystal *_lcd;
+		uint8_t _x;
+		uint8_t _y;
+		uint8_t _w;
+		uint8_t _h;
+		uint8_t _cur_x;
+		uint8_t _cur_y;
+		uint8_t _mode;
+		lcd_vt_t _vt;
+		lcd_utf_t _utf;
+};
+
+// a scrolling menu of PROGMEM labels in a w x h block at x, y, the
+// first column holds the selection marker. moving the selection only
+// rewrites the two marker cells, scrolling only rewrites the part of
+// each row whose text changed.
+class LiquidCrystalMenu {
+	public:
+		LiquidCrystalMenu (
+			LiquidCrystal &, uint8_t, uint8_t, uint8_t, uint8_t,
+			const char * const *, uint8_t, uint8_t = '>'
+		); // display, x, y, width, height, items (PROGMEM), count, marker
+
+		void draw (void);
+		void select (uint8_t);
+		void next (void);
+		void prev (void);
+		uint8_t selected (void);
+
+	private:
+		const char *_label (uint8_t);
+		uint8_t _rows (void);
+		uint8_t _cols (void);
+		void _mark (uint8_t, uint8_t);
+		void _diffRow (uint8_t, const char *, const char *);
+
+		LiquidCrystal *_lcd;
+		const char * const *_items; // PROGMEM table of PROGMEM labels
+		uint8_t _x;
+		uint8_t _y;
+		uint8_t _w;
+		uint8_t _h;
+		uint8_t _count; // number of items
+		uint8_t _top; // item on the first row
+		uint8_t _sel; // selected item
+		uint8_t _marker;
+};
+
 #endif // #ifndef LIQUID_CRYSTAL_H
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  LiquidCrystal benchmark workloads, run under simavr by simbench.c
+//
+//  each workload writes its number to GPIOR0 when it starts and 0 when
+//  it ends, simbench counts the cycles and bus strobes in between. when
+//  everything has run the cpu sleeps with interrupts off, which ends
+//  the simulation.
+//
+//  BENCH_WIRING selects the interface: 4 (4 bit), 8 (8 bit) or 0 (serial)
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <avr/sleep.h>
+#include "LiquidCrystal.h"
+
+#if BENCH_WIRING == 4
+LiquidCrystal lcd (12, 11, 5, 4, 3, 2); // rs, en (PB3), d4...d7
+#elif BENCH_WIRING == 8
+LiquidCrystal lcd (12, 11, 2, 3, 4, 5, 6, 7, 8, 9); // rs, en (PB3), d0...d7
+#else
+LiquidCrystal lcd (11, 10, 13); // sio, stb (PB2), sck
+#endif
+
+#define MARK(n) (GPIOR0 = (n))
+
+// workload numbers, simbench.c has the names
+#define W_PRINT  1 // print a full 20x4 screen
+#define W_FIELDS 2 // 100 numeric field updates
+#define W_GLYPHS 3 // upload 8 custom characters
+#define W_CLEAR  4 // clear()
+#define W_VT     5 // vt sequences and text through write()
+
+static const char *const screen[] = {
+	"Temperature  21.5 C ",
+	"Humidity     48 %   ",
+	"Pressure   1013 hPa ",
+	"Uptime   0d 01:23:45",
+};
+
+static const uint8_t glyph[8][8] = {
+	{ 0x04, 0x0E, 0x0E, 0x0E, 0x1F, 0x00, 0x04, 0x00 }, // bell
+	{ 0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00, 0x00 }, // heart
+	{ 0x0E, 0x11, 0x11, 0x1F, 0x1B, 0x1B, 0x1F, 0x00 }, // lock
+	{ 0x00, 0x01, 0x03, 0x16, 0x1C, 0x08, 0x00, 0x00 }, // check
+	{ 0x04, 0x0A, 0x0A, 0x0E, 0x0E, 0x1F, 0x1F, 0x0E }, // thermometer
+	{ 0x04, 0x04, 0x0A, 0x0A, 0x11, 0x11, 0x11, 0x0E }, // drop
+	{ 0x00, 0x0E, 0x15, 0x17, 0x11, 0x0E, 0x00, 0x00 }, // clock
+	{ 0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F }, // box
+};
+
+static const char vt[] =
+	"\x1b[2J"
+	"\x1b[0;0HStatus: \x1b[1mOK\x1b[0m"
+	"\x1b[0;1HLink up 100M full"
+	"\x1b[0;2H\x1b[2mRX 123456  TX 7890\x1b[0m"
+	"\x1b[0;3HLoad 0.42 0.37 0.30";
+
+void setup (void)
+{
+	static lcd_field_t fields[4];
+	uint8_t field[4];
+	uint8_t n;
+	int32_t v;
+	const char *p;
+
+	lcd.begin (20, 4);
+	lcd.setFields (fields, 4);
+
+	MARK (W_PRINT);
+
+	for (n = 0; n < 4; n++) {
+		lcd.setCursor (0, n);
+		lcd.print (screen[n]);
+	}
+
+	MARK (0);
+
+	for (n = 0; n < 4; n++) {
+		field[n] = lcd.defineField (12, n, 7, 1); // one decimal place
+	}
+
+	MARK (W_FIELDS);
+
+	for (v = 0; v < 100; v++) {
+		lcd.updateField (field[v & 3], (v * 37) - 1500);
+	}
+
+	MARK (0);
+	MARK (W_GLYPHS);
+
+	for (n = 0; n < 8; n++) {
+		lcd.createChar (n, glyph[n]);
+	}
+
+	MARK (0);
+	MARK (W_CLEAR);
+	lcd.clear();
+	MARK (0);
+	MARK (W_VT);
+
+	for (p = vt; *p; p++) {
+		lcd.write (*p);
+	}
+
+	MARK (0);
+
+	cli(); // sleeping with interrupts off ends the simulation
+	set_sleep_mode (SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	sleep_cpu();
+}
+
+void loop (void)
+{
+}
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  just enough of the Arduino AVR core to build LiquidCrystal.cpp on the
+//  host for the fakes in this directory. the I/O ports are plain memory
+//  (pins 0...7 are port 0 and so on), the SPI data register feeds the
+//  74HC595 model in host.cpp and __builtin_avr_delay_cycles() advances
+//  the clock micros() and millis() read.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+
+#define ARDUINO_HOST 1
+
+#define HIGH 0x1
+#define LOW  0x0
+
+// program memory and EEPROM
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char *
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p) (*(void * const *)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+extern uint8_t host_eeprom[1024];
+
+static inline uint8_t eeprom_read_byte (const uint8_t *addr)
+{
+	return host_eeprom[(uintptr_t)(addr) & 1023];
+}
+
+static inline void eeprom_update_byte (uint8_t *addr, uint8_t value)
+{
+	host_eeprom[(uintptr_t)(addr) & 1023] = value;
+}
+
+// I/O ports, 8 pins each
+extern volatile uint8_t host_io[3 * 8];
+extern volatile uint8_t SREG;
+
+#define digitalPinToPort(p) ((p) / 8)
+#define digitalPinToBitMask(p) ((uint8_t)(1 << ((p) % 8)))
+#define portOutputRegister(n) (&host_io[((n) * 3) + 0])
+#define portInputRegister(n) (&host_io[((n) * 3) + 1])
+#define portModeRegister(n) (&host_io[((n) * 3) + 2])
+
+#define cli() ((void)(0))
+#define sei() ((void)(0))
+#define _BV(b) (1 << (b))
+
+// SPI, on the same pins as an Uno. a byte written to SPDR is shifted
+// out at once, so SPIF always reads set.
+struct host_spdr_t {
+	void operator = (uint8_t);
+};
+
+extern host_spdr_t host_spdr;
+extern uint8_t host_spcr, host_spsr;
+
+#define SPDR host_spdr
+#define SPCR host_spcr
+#define SPSR host_spsr
+
+#define SPE   6
+#define MSTR  4
+#define SPIF  7
+#define SPI2X 0
+
+#define PIN_SPI_SS   10
+#define PIN_SPI_MOSI 11
+#define PIN_SPI_SCK  13
+
+// time
+#define F_CPU 16000000UL
+
+void host_delay (double cycles);
+unsigned long millis (void);
+unsigned long micros (void);
+
+#define __builtin_avr_delay_cycles(x) host_delay (x)
+
+// Print, the parts LiquidCrystal uses
+class Print {
+	public:
+		virtual size_t write (uint8_t) = 0;
+
+		virtual size_t write (const uint8_t *buf, size_t len)
+		{
+			size_t n = 0;
+
+			while (len--) {
+				n += write (*buf++);
+			}
+
+			return n;
+		}
+
+		size_t write (const char *str)
+		{
+			return write ((const uint8_t *)(str), strlen (str));
+		}
+
+		size_t print (const char *str)
+		{
+			return write (str);
+		}
+
+		size_t print (unsigned long value)
+		{
+			char buf[12];
+			snprintf (buf, sizeof (buf), "%lu", value);
+			return write (buf);
+		}
+
+		size_t print (long value)
+		{
+			char buf[12];
+			snprintf (buf, sizeof (buf), "%ld", value);
+			return write (buf);
+		}
+
+		size_t print (int value)
+		{
+			return print ((long)(value));
+		}
+
+		size_t print (unsigned int value)
+		{
+			return print ((unsigned long)(value));
+		}
+
+		size_t println (unsigned long value)
+		{
+			size_t n = print (value);
+			return n + write ("\r\n");
+		}
+
+		size_t println (unsigned int value)
+		{
+			return println ((unsigned long)(value));
+		}
+
+		size_t println (int value)
+		{
+			size_t n = print (value);
+			return n + write ("\r\n");
+		}
+};
+
+#endif // #ifndef HOST_ARDUINO_H
@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  HD44780 model for the host fakes, see hd44780.h
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "hd44780.h"
+
+// execution times in usec (HD44780U datasheet, 270 kHz clock)
+#define SLOW_US 1520 // clear display, return home
+#define FAST_US 37 // everything else
+#define DATA_US 41 // data write or read (37 + 4 for the address update)
+
+HD44780::HD44780 (void)
+{
+	_now = 0; // before reset() reads it
+	reset();
+}
+
+// power on state: 8 bit interface, increment, blank DDRAM
+void HD44780::reset (void)
+{
+	memset (ddram, ' ', sizeof (ddram));
+	memset (cgram, 0, sizeof (cgram));
+	addr = 0;
+	eight = 1;
+	commands = datas = early = mismatches = 0;
+	_ready = _now;
+	_cg = 0;
+	_inc = 1;
+	_lines2 = 0;
+	_half = 0;
+	_hi = 0;
+}
+
+void HD44780::write (uint8_t rs, uint8_t c)
+{
+	if (busy()) {
+		early++;
+	}
+
+	_exec (rs, c);
+}
+
+// in 4 bit mode two strobes make a byte, high half first. in 8 bit
+// mode (during the reset sequence) D3...D0 read as 0.
+void HD44780::nibble (uint8_t rs, uint8_t c)
+{
+	c &= 0x0F;
+
+	if (eight) {
+		write (rs, (c << 4));
+		return;
+	}
+
+	if (!_half) {
+		_hi = c;
+		_half = 1;
+		return;
+	}
+
+	_half = 0;
+	write (rs, ((_hi << 4) | c));
+}
+
+uint8_t HD44780::read (uint8_t rs)
+{
+	uint8_t c;
+
+	if (!rs) {
+		return ((busy() ? 0x80 : 0) | (addr & 0x7F));
+	}
+
+	c = (_cg ? cgram[addr & 0x3F] : ddram[addr & 0x7F]);
+	_step();
+	_ready = (_now + DATA_US);
+	return c;
+}
+
+void HD44780::wait (unsigned long usec)
+{
+	_now += usec;
+}
+
+uint8_t HD44780::busy (void)
+{
+	return ((long)(_ready - _now) > 0);
+}
+
+// "C 80 40" = command 0x80, 40 usec after the previous entry.
+// C = command, D = data, S = status read, R = data read. reads are
+// checked against what the display returned when it was recorded.
+uint8_t HD44780::replay (const char *line)
+{
+	char type;
+	unsigned int c;
+	unsigned long usec;
+
+	if (sscanf (line, " %c %2x %lu", &type, &c, &usec) != 3) {
+		return 0;
+	}
+
+	wait (usec);
+
+	switch (type) {
+		case 'C': {
+			write (0, c);
+			return 1;
+		}
+		case 'D': {
+			write (1, c);
+			return 1;
+		}
+		case 'S': {
+			mismatches += ((read (0) & 0x7F) != (c & 0x7F)); // the busy flag depends on timing
+			return 1;
+		}
+		case 'R': {
+			mismatches += (read (1) != c);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void HD44780::dump (uint8_t cols, uint8_t rows)
+{
+	char buf[41];
+	uint8_t y;
+
+	for (y = 0; y < rows; y++) {
+		buf[row (y, buf, cols)] = 0;
+		printf ("|%s|\n", buf);
+	}
+}
+
+// a line as printable text, rows 2 and 3 are the second half of rows 0 and 1
+uint8_t HD44780::row (uint8_t y, char *buf, uint8_t cols)
+{
+	static const uint8_t offset[4] = { 0x00, 0x40, 0x14, 0x54 };
+	uint8_t x, c;
+
+	for (x = 0; x < cols; x++) {
+		c = ddram[(offset[y & 3] + x) & 0x7F];
+		buf[x] = ((c >= ' ') && (c < 0x7F)) ? c : '.';
+	}
+
+	return cols;
+}
+
+void HD44780::_exec (uint8_t rs, uint8_t c)
+{
+	if (rs) {
+		_cg ? cgram[addr & 0x3F] = c : ddram[addr & 0x7F] = c;
+		_step();
+		_ready = (_now + DATA_US);
+		datas++;
+		return;
+	}
+
+	commands++;
+	_ready = (_now + FAST_US);
+
+	if (c & 0x80) { // set DDRAM address
+		addr = (c & 0x7F);
+		_cg = 0;
+
+	} else if (c & 0x40) { // set CGRAM address
+		addr = (c & 0x3F);
+		_cg = 1;
+
+	} else if (c & 0x20) { // function set
+		eight = !!(c & 0x10);
+		_lines2 = !!(c & 0x08);
+		_half = 0;
+
+	} else if (c & 0x10) { // cursor or display shift, text is not moved
+
+	} else if (c & 0x08) { // display control
+
+	} else if (c & 0x04) { // entry mode
+		_inc = !!(c & 0x02);
+
+	} else if (c & 0x02) { // return home
+		addr = 0;
+		_cg = 0;
+		_ready = (_now + SLOW_US);
+
+	} else if (c & 0x01) { // clear display
+		memset (ddram, ' ', sizeof (ddram));
+		addr = 0;
+		_cg = 0;
+		_inc = 1;
+		_ready = (_now + SLOW_US);
+	}
+}
+
+void HD44780::_step (void)
+{
+	if (_cg) {
+		addr = ((addr + (_inc ? 1 : -1)) & 0x3F);
+
+	} else if (_lines2) { // 0x00...0x27 and 0x40...0x67
+		addr += (_inc ? 1 : -1);
+		addr = (addr == 0x28) ? 0x40 : (addr == 0x68) ? 0x00 : (addr == 0x3F) ? 0x27 : (addr == 0xFF) ? 0x67 : addr;
+
+	} else { // 0x00...0x4F
+		addr += (_inc ? 1 : -1);
+		addr = (addr == 0x50) ? 0x00 : (addr == 0xFF) ? 0x4F : addr;
+	}
+}
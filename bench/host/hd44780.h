@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  HD44780 model for the host fakes: DDRAM, CGRAM, the address counter,
+//  4 and 8 bit interface mode and instruction execution times. it is
+//  fed whole bytes (a replayed trace) or nibbles (a 4 bit bus).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HD44780_H
+#define HD44780_H
+
+#include <stdint.h>
+
+class HD44780 {
+	public:
+		HD44780 (void);
+
+		void reset (void);
+		void write (uint8_t rs, uint8_t c); // one byte, whatever the interface width
+		void nibble (uint8_t rs, uint8_t c); // D7...D4 of one EN strobe
+		uint8_t read (uint8_t rs);
+		void wait (unsigned long usec); // time passes
+		uint8_t busy (void); // still executing the last instruction
+		uint8_t replay (const char *line); // one dumpTrace() line, 0 if it isn't one
+
+		void dump (uint8_t cols, uint8_t rows); // print the screen
+		uint8_t row (uint8_t y, char *buf, uint8_t cols); // copy a line, returns cols
+
+		uint8_t ddram[128];
+		uint8_t cgram[64];
+		uint8_t addr; // address counter
+		uint8_t eight; // 8 bit interface
+		unsigned long commands; // instructions executed
+		unsigned long datas; // data bytes written
+		unsigned long early; // bytes sent while busy (lost on a real display)
+		unsigned long mismatches; // replayed reads that returned something else
+
+	private:
+		void _exec (uint8_t rs, uint8_t c);
+		void _step (void);
+
+		unsigned long _now; // usec
+		unsigned long _ready; // _now when the last instruction is done
+		uint8_t _cg; // address counter points to CGRAM
+		uint8_t _inc; // increment after a transfer
+		uint8_t _lines2; // two line DDRAM layout
+		uint8_t _half; // first nibble of a byte received
+		uint8_t _hi; // ...and its value
+};
+
+#endif // #ifndef HD44780_H
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  host side of Arduino.h: port memory, the clock and a 74HC595 wired
+//  as LiquidCrystal expects (Q7...Q4 = D7...D4, Q3 = EN, Q2 = RS) in
+//  front of the HD44780 model.
+//
+//  the 595 is driven through SPI. the driver latches after every byte
+//  it shifts, so each byte written to SPDR is taken as the new output
+//  state. the display takes a nibble on each falling EN edge.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Arduino.h"
+#include "host.h"
+
+#define SR_EN (1<<3)
+#define SR_RS (1<<2)
+
+uint8_t host_eeprom[1024];
+volatile uint8_t host_io[3 * 8];
+volatile uint8_t SREG;
+
+host_spdr_t host_spdr;
+uint8_t host_spcr, host_spsr;
+
+HD44780 host_lcd;
+unsigned long host_shifts; // bytes shifted into the 595
+unsigned long host_tas; // EN rose together with an RS change
+
+static unsigned long host_usec;
+static uint8_t host_sr; // 595 outputs
+
+void host_spdr_t::operator = (uint8_t c)
+{
+	host_shifts++;
+
+	if (!(host_sr & SR_EN) && (c & SR_EN) && ((c ^ host_sr) & SR_RS)) {
+		host_tas++; // no RS setup time before EN rose
+	}
+
+	if ((host_sr & SR_EN) && !(c & SR_EN)) {
+		host_lcd.nibble (!!(host_sr & SR_RS), (host_sr >> 4));
+	}
+
+	host_sr = c;
+	SPSR |= _BV (SPIF);
+}
+
+void host_delay (double cycles)
+{
+	unsigned long usec = (unsigned long)(cycles / (F_CPU / 1000000UL));
+
+	host_usec += usec;
+	host_lcd.wait (usec);
+}
+
+unsigned long millis (void)
+{
+	return (host_usec / 1000);
+}
+
+unsigned long micros (void)
+{
+	return host_usec;
+}
@@ -0,0 +1,16 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  the display and 74HC595 behind the host Arduino.h, see host.cpp
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HOST_H
+#define HOST_H
+
+#include "hd44780.h"
+
+extern HD44780 host_lcd;
+extern unsigned long host_shifts; // bytes shifted into the 595
+extern unsigned long host_tas; // EN rose together with an RS change
+
+#endif // #ifndef HOST_H
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  replay a bus trace from dumpTrace() on the HD44780 model
+//
+//  usage: replay [-c cols] [-r rows] [file]
+//
+//  prints the screen the trace leaves, the time it covers and every
+//  byte that came while the display was still busy with the previous
+//  instruction (a real display drops those). reads are checked against
+//  what the display returned when the trace was recorded. lines that
+//  aren't trace entries (whatever else was printed on the port) are
+//  skipped.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hd44780.h"
+
+int main (int argc, char *argv[])
+{
+	HD44780 lcd;
+	FILE *in = stdin;
+	char line[128];
+	unsigned long entries = 0;
+	unsigned long usec = 0;
+	unsigned long early;
+	unsigned long delta;
+	uint8_t cols = 20;
+	uint8_t rows = 4;
+	int n;
+
+	for (n = 1; n < argc; n++) {
+		if ((strcmp (argv[n], "-c") == 0) && ((n + 1) < argc)) {
+			cols = atoi (argv[++n]);
+
+		} else if ((strcmp (argv[n], "-r") == 0) && ((n + 1) < argc)) {
+			rows = atoi (argv[++n]);
+
+		} else if (!(in = fopen (argv[n], "r"))) {
+			fprintf (stderr, "replay: can't open %s\n", argv[n]);
+			return 1;
+		}
+	}
+
+	cols = (cols > 40) ? 40 : cols;
+	rows = (rows > 4) ? 4 : rows;
+
+	while (fgets (line, sizeof (line), in)) {
+		early = lcd.early;
+		delta = 0;
+
+		if (!lcd.replay (line)) {
+			continue;
+		}
+
+		sscanf (line, " %*c %*x %lu", &delta);
+		usec += delta;
+		entries++;
+
+		if (lcd.early != early) {
+			printf ("early: entry %lu (%.*s) at %lu usec\n", entries, 4, line, usec);
+		}
+	}
+
+	lcd.dump (cols, rows);
+	printf ("%lu entries, %lu usec, %lu commands, %lu data, %lu early, %lu read mismatches\n",
+		entries, usec, lcd.commands, lcd.datas, lcd.early, lcd.mismatches);
+
+	return ((lcd.early || lcd.mismatches) ? 2 : 0);
+}
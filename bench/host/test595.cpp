@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  74HC595 transport on the host: the latch stream is decoded into the
+//  HD44780 model and the DDRAM is checked, through the 8 bit reset
+//  sequence (one nibble per byte) and in 4 bit mode after it.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "LiquidCrystal.h"
+#include "host.h"
+
+static int failed;
+
+static void check (const char *what, int ok)
+{
+	printf ("%s %s\n", ok ? "ok  " : "FAIL", what);
+	failed += !ok;
+}
+
+// compare one row of the model's DDRAM with text (padded with spaces)
+static int row (uint8_t y, const char *text)
+{
+	char buf[21];
+	char want[21];
+
+	host_lcd.row (y, buf, 20);
+	memset (want, ' ', 20);
+	memcpy (want, text, strlen (text));
+	return (memcmp (buf, want, 20) == 0);
+}
+
+int main (void)
+{
+	static const uint8_t bell[8] = { 0x04, 0x0E, 0x0E, 0x0E, 0x1F, 0x00, 0x04, 0x00 };
+	LiquidCrystal lcd (SR595, PIN_SPI_MOSI, PIN_SPI_SCK, 12); // data, clock, latch
+	unsigned long shifts;
+
+	check ("data on MOSI and clock on SCK use the SPI hardware", (SPCR & _BV (SPE)) && (SPCR & _BV (MSTR)));
+
+	lcd.begin (20, 4);
+	check ("the reset sequence leaves the display in 4 bit mode", !host_lcd.eight);
+	check ("begin() clears the display", row (0, "") && row (3, ""));
+
+	lcd.print ("Hello 595");
+	lcd.setCursor (2, 1);
+	lcd.print ("second");
+	lcd.setCursor (0, 2);
+	lcd.print ("third line");
+	lcd.setCursor (14, 3);
+	lcd.print ("bottom");
+	check ("row 0", row (0, "Hello 595"));
+	check ("row 1", row (1, "  second"));
+	check ("row 2", row (2, "third line"));
+	check ("row 3", row (3, "              bottom"));
+
+	lcd.createChar (1, bell);
+	lcd.setCursor (19, 0);
+	lcd.write (1);
+	check ("custom character in CGRAM", memcmp (host_lcd.cgram + 8, bell, 8) == 0);
+	check ("custom character on screen", host_lcd.ddram[19] == 1);
+
+	lcd.setCursor (0, 0);
+	shifts = host_shifts;
+	lcd.print ("J");
+	check ("data after a command takes one setup shift more", (host_shifts - shifts) == 5);
+
+	shifts = host_shifts;
+	lcd.print ("ump");
+	check ("data after data takes 4 shifts a byte", (host_shifts - shifts) == 12);
+
+	shifts = host_shifts;
+	lcd.setCursor (0, 3);
+	check ("a command after data takes one setup shift more", (host_shifts - shifts) == 5);
+	check ("row 0 after a rewrite", (memcmp (host_lcd.ddram, "Jumpo 595", 9) == 0) && (host_lcd.ddram[19] == 1));
+
+	lcd.begin (16, 2); // reset sequence again, from 4 bit mode
+	lcd.print ("again");
+	check ("begin() from 4 bit mode resyncs and clears", !host_lcd.eight && row (0, "again") && row (1, ""));
+
+	check ("RS is latched before EN rises", host_tas == 0);
+
+	printf ("%s\n", failed ? "test595: FAILED" : "test595: passed");
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  LiquidCrystal benchmark harness for simavr
+//
+//  usage: simbench <elf> <nodelay elf> <4bit | 8bit | serial>
+//
+//  runs both builds of bench.cpp on a simulated ATmega328P at 16 MHz.
+//  bench.cpp writes a workload number to GPIOR0 when a workload starts
+//  and 0 when it ends. for each workload this prints
+//
+//    cycles  cpu cycles between the two markers
+//    bus     bus transactions (bytes to or from the display). counted on
+//            the strobe pin bench.cpp wires up: EN falling for parallel
+//            wiring, two per byte on 4 bit, and STB rising for serial
+//    delay   cycles spent in __builtin_avr_delay_cycles(), the normal
+//            build minus the build where it is compiled out
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "avr_ioport.h"
+
+#define MCU "atmega328p"
+#define FREQUENCY 16000000
+#define GPIOR0_ADDR 0x3E // data space address of GPIOR0 on the ATmega328P
+#define MAX_CYCLES (60ULL * FREQUENCY) // give up after a minute of simulated time
+#define WORKLOADS 6
+
+// same numbers as the W_* defines in bench.cpp
+static const char *names[WORKLOADS] = {
+	"", "print 20x4", "numeric fields", "8 glyphs", "clear()", "vt via write()"
+};
+
+typedef struct {
+	uint64_t cycles[WORKLOADS]; // per workload results
+	uint32_t bus[WORKLOADS];
+	uint64_t start; // cycle count at the start marker
+	uint32_t edges; // strobe edges so far
+	uint32_t start_edges; // strobe edges at the start marker
+	uint8_t current; // workload running (0 = none)
+	uint8_t level; // last level of the strobe pin
+	uint8_t edge; // level that counts (1 = rising, 0 = falling)
+	uint8_t per; // strobes per transaction
+} bench_t;
+
+// strobe pin of each wiring in bench.cpp
+typedef struct {
+	const char *name;
+	char port;
+	uint8_t bit;
+	uint8_t edge;
+	uint8_t per;
+} wiring_t;
+
+static const wiring_t wirings[] = {
+	{ "4bit",   'B', 3, 0, 2 }, // EN on pin 11, a nibble per strobe
+	{ "8bit",   'B', 3, 0, 1 }, // EN on pin 11
+	{ "serial", 'B', 2, 1, 1 }, // STB on pin 10, released after each byte
+};
+
+// GPIOR0 write, ends the running workload and starts the next one
+static void marker (avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+	bench_t *b = (bench_t *)(param);
+
+	if (b->current && (b->current < WORKLOADS)) {
+		b->cycles[b->current] += (avr->cycle - b->start);
+		b->bus[b->current] += ((b->edges - b->start_edges) / b->per); // workloads send whole bytes
+	}
+
+	b->current = v;
+	b->start = avr->cycle;
+	b->start_edges = b->edges;
+	avr->data[addr] = v;
+}
+
+// strobe pin changed
+static void strobe (avr_irq_t *irq, uint32_t value, void *param)
+{
+	bench_t *b = (bench_t *)(param);
+
+	(void)(irq);
+	value = (value ? 1 : 0);
+
+	if (value != b->level) {
+		b->level = value;
+
+		if (value == b->edge) {
+			b->edges++;
+		}
+	}
+}
+
+// run one firmware image to the end, returns 0 if it finished
+static int run (const char *file, bench_t *b, const wiring_t *w)
+{
+	elf_firmware_t fw;
+	avr_t *avr;
+	int state;
+
+	memset (&fw, 0, sizeof (fw));
+
+	if (elf_read_firmware (file, &fw)) {
+		fprintf (stderr, "simbench: can't read %s\n", file);
+		return -1;
+	}
+
+	if (!(avr = avr_make_mcu_by_name (MCU))) {
+		fprintf (stderr, "simbench: simavr has no %s\n", MCU);
+		return -1;
+	}
+
+	fw.frequency = FREQUENCY;
+	avr_init (avr);
+	avr_load_firmware (avr, &fw);
+	avr_register_io_write (avr, GPIOR0_ADDR, marker, b);
+	avr_irq_register_notify (avr_io_getirq (avr, AVR_IOCTL_IOPORT_GETIRQ (w->port), w->bit), strobe, b);
+
+	do {
+		state = avr_run (avr);
+	} while ((state != cpu_Done) && (state != cpu_Crashed) && (avr->cycle < MAX_CYCLES));
+
+	if (state != cpu_Done) {
+		fprintf (stderr, "simbench: %s didn't finish\n", file);
+	}
+
+	avr_terminate (avr);
+	return ((state == cpu_Done) ? 0 : -1);
+}
+
+int main (int argc, char *argv[])
+{
+	bench_t normal, nodelay;
+	const wiring_t *w = 0;
+	uint64_t delay;
+	int n;
+
+	for (n = 0; (argc == 4) && (n < (int)(sizeof (wirings) / sizeof (*wirings))); n++) {
+		if (strcmp (argv[3], wirings[n].name) == 0) {
+			w = &wirings[n];
+		}
+	}
+
+	if (!w) {
+		fprintf (stderr, "usage: simbench <elf> <nodelay elf> <4bit | 8bit | serial>\n");
+		return 2;
+	}
+
+	memset (&normal, 0, sizeof (normal));
+	normal.edge = w->edge;
+	normal.per = w->per;
+	nodelay = normal;
+
+	if (run (argv[1], &normal, w) || run (argv[2], &nodelay, w)) {
+		return 1;
+	}
+
+	printf ("%s\n", argv[1]);
+	printf ("%-16s %10s %8s %10s %10s\n", "workload", "cycles", "bus", "delay", "usec");
+
+	for (n = 1; n < WORKLOADS; n++) {
+		delay = (normal.cycles[n] > nodelay.cycles[n]) ? (normal.cycles[n] - nodelay.cycles[n]) : 0;
+		printf ("%-16s %10llu %8u %10llu %10.1f\n", names[n],
+			(unsigned long long)(normal.cycles[n]), normal.bus[n],
+			(unsigned long long)(delay), (normal.cycles[n] / (FREQUENCY / 1e6)));
+	}
+
+	return 0;
+}